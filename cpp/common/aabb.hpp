@@ -0,0 +1,71 @@
+#pragma once
+
+#include "vec3.hpp"
+#include <algorithm>
+
+namespace cgfs
+{
+
+// Axis-aligned bounding box.
+struct Aabb final
+{
+    Point3 min{ kInfinity, kInfinity, kInfinity };
+    Point3 max{ -kInfinity, -kInfinity, -kInfinity };
+
+    auto grow(const Point3& p) -> void
+    {
+        min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+        max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+    }
+
+    auto grow(const Aabb& other) -> void
+    {
+        grow(other.min);
+        grow(other.max);
+    }
+
+    auto center() const -> Point3
+    {
+        return (min + max) * 0.5f;
+    }
+
+    auto extents() const -> Vec3
+    {
+        return max - min;
+    }
+
+    // Half the surface area, which is all the SAH needs since it only compares ratios.
+    auto half_area() const -> float
+    {
+        const Vec3 e = extents();
+        return (e.x * e.y) + (e.y * e.z) + (e.z * e.x);
+    }
+
+    auto is_empty() const -> bool
+    {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+};
+
+// Slab test. `inv_direction` is 1/ray.direction, precomputed once per ray.
+// Returns the entry distance along the ray or kInfinity if the box is missed.
+inline auto intersect_ray_aabb(const Aabb& box,
+                               const Point3& origin,
+                               const Vec3& inv_direction,
+                               const float min_t,
+                               const float max_t) -> float
+{
+    const float tx0 = (box.min.x - origin.x) * inv_direction.x;
+    const float tx1 = (box.max.x - origin.x) * inv_direction.x;
+    const float ty0 = (box.min.y - origin.y) * inv_direction.y;
+    const float ty1 = (box.max.y - origin.y) * inv_direction.y;
+    const float tz0 = (box.min.z - origin.z) * inv_direction.z;
+    const float tz1 = (box.max.z - origin.z) * inv_direction.z;
+
+    const float t_enter = std::max({ std::min(tx0, tx1), std::min(ty0, ty1), std::min(tz0, tz1), min_t });
+    const float t_exit  = std::min({ std::max(tx0, tx1), std::max(ty0, ty1), std::max(tz0, tz1), max_t });
+
+    return (t_enter <= t_exit) ? t_enter : kInfinity;
+}
+
+} // cgfs
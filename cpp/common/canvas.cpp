@@ -9,6 +9,8 @@ namespace cgfs
 
 auto Canvas::present() const -> bool
 {
+    assert(m_window.width == m_dimensions.width && m_window.height == m_dimensions.height);
+
     const int bytes_per_pixel = 4; // RGBA U8 Color
     const int stride_in_bytes = m_dimensions.width * bytes_per_pixel;
     
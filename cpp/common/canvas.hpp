@@ -5,6 +5,7 @@
 
 #include <cstdint>
 #include <vector>
+#include <span>
 #include <string>
 
 namespace cgfs
@@ -16,36 +17,61 @@ public:
 
     explicit Canvas(const Dims dimensions, std::string name = "canvas", const Color& clearColor = Color::kBlack)
         : m_dimensions{ dimensions }
+        , m_window{ 0, 0, dimensions.width, dimensions.height }
         , m_name{ std::move(name) }
     {
         assert(m_dimensions.is_valid());
         m_pixel_buffer.resize(m_dimensions.width * m_dimensions.height, Color::to_rgba_u8(clearColor));
     }
 
+    // Slice of a canvas with the given dimensions that only stores the pixels inside `window`.
+    // Pixels drawn outside of it are discarded, which lets threads draw disjoint slices of the
+    // same image. Coordinates and projections still refer to the full canvas.
+    Canvas(const Dims dimensions, const ScreenRect& window)
+        : m_dimensions{ dimensions }
+        , m_window{ window }
+        , m_name{ "slice" }
+    {
+        assert(m_dimensions.is_valid());
+        assert((ScreenRect{ 0, 0, dimensions.width, dimensions.height }.contains(m_window)));
+        m_pixel_buffer.resize(m_window.width * m_window.height);
+    }
+
     // Canvas origin (0,0) is at the center.
     // x = [-canvas.w/2, canvas.w/2]
     // y = [-canvas.h/2, canvas.h/2]
     auto draw_pixel(const Point2 point, const Color& color) -> void
     {
-        // Map back to "screen" coords with origin at the top-left corner.
-        const auto x = ((m_dimensions.width  / 2) + point.x);
-        const auto y = ((m_dimensions.height / 2) - point.y - 1);
+        // Map back to "screen" coords with origin at the top-left corner, then into the window.
+        const auto x = ((m_dimensions.width  / 2) + point.x) - m_window.x;
+        const auto y = ((m_dimensions.height / 2) - point.y - 1) - m_window.y;
 
-        if (x < 0 || x >= m_dimensions.width ||
-            y < 0 || y >= m_dimensions.height) [[unlikely]]
+        if (x < 0 || x >= m_window.width ||
+            y < 0 || y >= m_window.height) [[unlikely]]
         {
             return;
         }
 
-        const std::size_t pixel_idx = x + (y * m_dimensions.width);
+        const std::size_t pixel_idx = x + (y * m_window.width);
         assert(pixel_idx < m_pixel_buffer.size());
 
         m_pixel_buffer[pixel_idx] = Color::to_rgba_u8(color);
     }
 
-    // "Present" the canvas into a PNG image file.
+    // "Present" the canvas into a PNG image file. Not for slices.
     auto present() const -> bool;
 
+    // Copies the pixels inside this canvas' window from/to a canvas covering it.
+    auto copy_window_from(const Canvas& source) -> void
+    {
+        copy_window_pixels(source.m_pixel_buffer.data(), source.m_window, m_pixel_buffer.data(), m_window, m_window);
+    }
+
+    auto copy_window_to(Canvas& dest) const -> void
+    {
+        copy_window_pixels(m_pixel_buffer.data(), m_window, dest.m_pixel_buffer.data(), dest.m_window, m_window);
+    }
+
     // Set whole canvas to the given pixel color.
     auto clear(const Color& clearColor = Color::kBlack) -> void;
 
@@ -53,10 +79,19 @@ public:
     auto to_viewport(const Point2 point,
                      const float viewport_size = 1.0f,
                      const float projection_plane_z = 1.0f) const -> Vec3
+    {
+        return to_viewport(static_cast<float>(point.x), static_cast<float>(point.y),
+                           viewport_size, projection_plane_z);
+    }
+
+    // Same as above, but for sub-pixel canvas positions.
+    auto to_viewport(const float x, const float y,
+                     const float viewport_size = 1.0f,
+                     const float projection_plane_z = 1.0f) const -> Vec3
     {
         return {
-            static_cast<float>(point.x) * viewport_size / static_cast<float>(m_dimensions.width),
-            static_cast<float>(point.y) * viewport_size / static_cast<float>(m_dimensions.height),
+            x * viewport_size / static_cast<float>(m_dimensions.width),
+            y * viewport_size / static_cast<float>(m_dimensions.height),
             projection_plane_z
         };
     }
@@ -93,8 +128,24 @@ public:
     auto width() const -> int { return m_dimensions.width; }
     auto height() const -> int { return m_dimensions.height; }
     auto dimensions() const -> Dims { return m_dimensions; }
+    auto window() const -> const ScreenRect& { return m_window; }
+
+    // Corners of the window in centered canvas coordinates (both inclusive); see draw_pixel().
+    auto window_min() const -> Point2
+    {
+        return { m_window.x - (m_dimensions.width / 2), (m_dimensions.height / 2) - m_window.y - m_window.height };
+    }
+
+    auto window_max() const -> Point2
+    {
+        return { m_window.x + m_window.width - 1 - (m_dimensions.width / 2), (m_dimensions.height / 2) - m_window.y - 1 };
+    }
+
     auto name() const -> const std::string& { return m_name; }
 
+    // Raw RGBA rows of the window, top row first.
+    auto pixels() -> std::span<RGBA_U8> { return m_pixel_buffer; }
+
     // No copy.
     Canvas(const Canvas& other) = delete;
     Canvas& operator=(const Canvas& other) = delete;
@@ -103,6 +154,7 @@ private:
 
     std::vector<RGBA_U8> m_pixel_buffer{};
     const Dims m_dimensions{};
+    const ScreenRect m_window{}; // Part of the canvas stored in m_pixel_buffer.
     const std::string m_name{};
 };
 
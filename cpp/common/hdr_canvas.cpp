@@ -0,0 +1,69 @@
+#include "hdr_canvas.hpp"
+
+#include <algorithm>
+
+namespace cgfs
+{
+
+static auto quantize(const float value) -> std::uint8_t
+{
+    // Truncates like Color::to_rgba_u8() so kClamp matches drawing straight into a Canvas.
+    return static_cast<std::uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+}
+
+// One branch-free pass over the planes per operator, so the compiler can vectorize the loop body.
+template<typename ToneMapFunc>
+static auto resolve_pixels(const float* red, const float* green, const float* blue, const float* weight,
+                           RGBA_U8* out_pixels, const std::size_t pixel_count, const float exposure,
+                           ToneMapFunc&& tone_map) -> void
+{
+    for (std::size_t i = 0; i < pixel_count; ++i)
+    {
+        const float scale = (weight[i] > 0.0f) ? (exposure / weight[i]) : 0.0f;
+
+        out_pixels[i] = {
+            quantize(tone_map(red[i] * scale)),
+            quantize(tone_map(green[i] * scale)),
+            quantize(tone_map(blue[i] * scale)),
+            255
+        };
+    }
+}
+
+auto HdrCanvas::clear() -> void
+{
+    std::fill(m_red.begin(), m_red.end(), 0.0f);
+    std::fill(m_green.begin(), m_green.end(), 0.0f);
+    std::fill(m_blue.begin(), m_blue.end(), 0.0f);
+    std::fill(m_weight.begin(), m_weight.end(), 0.0f);
+}
+
+auto HdrCanvas::resolve(Canvas& canvas, const ToneMapping tone_mapping, const float exposure) const -> void
+{
+    assert(canvas.width() == m_dimensions.width && canvas.height() == m_dimensions.height);
+    assert(canvas.window().width == m_dimensions.width && canvas.window().height == m_dimensions.height);
+
+    const std::span<RGBA_U8> out_pixels = canvas.pixels();
+    assert(out_pixels.size() == m_weight.size());
+
+    switch (tone_mapping)
+    {
+    case ToneMapping::kClamp:
+        resolve_pixels(m_red.data(), m_green.data(), m_blue.data(), m_weight.data(),
+                       out_pixels.data(), out_pixels.size(), exposure,
+                       [](const float c) { return c; });
+        break;
+    case ToneMapping::kReinhard:
+        resolve_pixels(m_red.data(), m_green.data(), m_blue.data(), m_weight.data(),
+                       out_pixels.data(), out_pixels.size(), exposure,
+                       [](const float c) { return c / (1.0f + c); });
+        break;
+    case ToneMapping::kAcesFilmic:
+        resolve_pixels(m_red.data(), m_green.data(), m_blue.data(), m_weight.data(),
+                       out_pixels.data(), out_pixels.size(), exposure,
+                       [](const float c) { return (c * ((2.51f * c) + 0.03f)) / ((c * ((2.43f * c) + 0.59f)) + 0.14f); });
+        break;
+    }
+}
+
+} // cgfs
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "canvas.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace cgfs
+{
+
+// Operator mapping unbounded HDR colors to the displayable [0,1] range.
+enum class ToneMapping : int
+{
+    kClamp,     // Values above 1 saturate; identical to drawing straight into a Canvas.
+    kReinhard,  // c / (1 + c)
+    kAcesFilmic // Narkowicz's fit of the ACES filmic curve.
+};
+
+// Floating point render target with the same dimensions and coordinate system as Canvas.
+// Colors are not clamped and can be accumulated over several samples or frames; resolve()
+// converts the whole image to 8-bit once at the end. Channels are stored as separate planes
+// so that the resolve loop vectorizes.
+class HdrCanvas final
+{
+public:
+
+    explicit HdrCanvas(const Dims dimensions)
+        : m_dimensions{ dimensions }
+    {
+        assert(m_dimensions.is_valid());
+
+        const std::size_t pixel_count = m_dimensions.width * m_dimensions.height;
+        m_red.resize(pixel_count, 0.0f);
+        m_green.resize(pixel_count, 0.0f);
+        m_blue.resize(pixel_count, 0.0f);
+        m_weight.resize(pixel_count, 0.0f);
+    }
+
+    // Replaces the pixel with a single sample.
+    auto draw_pixel(const Point2 point, const Color& color) -> void
+    {
+        const std::size_t pixel_idx = to_pixel_index(point);
+        if (pixel_idx != kInvalidPixel)
+        {
+            m_red[pixel_idx]    = color.r;
+            m_green[pixel_idx]  = color.g;
+            m_blue[pixel_idx]   = color.b;
+            m_weight[pixel_idx] = 1.0f;
+        }
+    }
+
+    // Adds a weighted sample to the pixel; resolve() outputs the weighted average.
+    auto accumulate_pixel(const Point2 point, const Color& color, const float weight = 1.0f) -> void
+    {
+        const std::size_t pixel_idx = to_pixel_index(point);
+        if (pixel_idx != kInvalidPixel)
+        {
+            m_red[pixel_idx]    += color.r * weight;
+            m_green[pixel_idx]  += color.g * weight;
+            m_blue[pixel_idx]   += color.b * weight;
+            m_weight[pixel_idx] += weight;
+        }
+    }
+
+    // Average of the samples written to the pixel so far; black if none.
+    auto pixel(const Point2 point) const -> Color
+    {
+        const std::size_t pixel_idx = to_pixel_index(point);
+        if (pixel_idx == kInvalidPixel || m_weight[pixel_idx] <= 0.0f)
+        {
+            return Color::kBlack;
+        }
+
+        const float inv_weight = 1.0f / m_weight[pixel_idx];
+        return { m_red[pixel_idx] * inv_weight, m_green[pixel_idx] * inv_weight, m_blue[pixel_idx] * inv_weight };
+    }
+
+    // Removes all samples.
+    auto clear() -> void;
+
+    // Tonemaps and quantizes every pixel into `canvas`, which must have the same dimensions.
+    // `exposure` scales the averaged colors before tone mapping. Pixels with no samples resolve to black.
+    auto resolve(Canvas& canvas, const ToneMapping tone_mapping = ToneMapping::kClamp, const float exposure = 1.0f) const -> void;
+
+    // Same mapping as Canvas::to_viewport(), for sub-pixel canvas positions.
+    auto to_viewport(const float x, const float y,
+                     const float viewport_size = 1.0f,
+                     const float projection_plane_z = 1.0f) const -> Vec3
+    {
+        return {
+            x * viewport_size / static_cast<float>(m_dimensions.width),
+            y * viewport_size / static_cast<float>(m_dimensions.height),
+            projection_plane_z
+        };
+    }
+
+    auto width() const -> int { return m_dimensions.width; }
+    auto height() const -> int { return m_dimensions.height; }
+    auto dimensions() const -> Dims { return m_dimensions; }
+
+    // No copy.
+    HdrCanvas(const HdrCanvas& other) = delete;
+    HdrCanvas& operator=(const HdrCanvas& other) = delete;
+
+private:
+
+    static constexpr std::size_t kInvalidPixel = ~std::size_t{ 0 };
+
+    // Centered canvas coordinates to an index into the planes; same layout as the Canvas pixel buffer.
+    auto to_pixel_index(const Point2 point) const -> std::size_t
+    {
+        const auto x = ((m_dimensions.width  / 2) + point.x);
+        const auto y = ((m_dimensions.height / 2) - point.y - 1);
+
+        if (x < 0 || x >= m_dimensions.width ||
+            y < 0 || y >= m_dimensions.height) [[unlikely]]
+        {
+            return kInvalidPixel;
+        }
+
+        return x + (y * m_dimensions.width);
+    }
+
+    std::vector<float> m_red{};
+    std::vector<float> m_green{};
+    std::vector<float> m_blue{};
+    std::vector<float> m_weight{}; // Sum of sample weights; 0=no samples.
+    const Dims m_dimensions{};
+};
+
+} // cgfs
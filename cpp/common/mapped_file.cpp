@@ -0,0 +1,63 @@
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cgfs
+{
+
+MappedFile::MappedFile(const std::string& filename)
+{
+    m_fd = ::open(filename.c_str(), O_RDONLY);
+    if (m_fd < 0)
+    {
+        return;
+    }
+
+    struct stat file_stat{};
+    if (::fstat(m_fd, &file_stat) != 0)
+    {
+        close();
+        return;
+    }
+
+    m_size = static_cast<std::size_t>(file_stat.st_size);
+    if (m_size == 0)
+    {
+        return; // Nothing to map, but still a valid empty file.
+    }
+
+    void* const data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close();
+        return;
+    }
+
+    ::madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+auto MappedFile::close() -> void
+{
+    if (m_data != nullptr)
+    {
+        ::munmap(const_cast<char*>(m_data), m_size);
+        m_data = nullptr;
+    }
+
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+} // cgfs
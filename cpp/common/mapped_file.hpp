@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace cgfs
+{
+
+// Read-only memory mapping of a whole file.
+class MappedFile final
+{
+public:
+
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    auto is_open() const -> bool
+    {
+        return m_fd >= 0;
+    }
+
+    auto data() const -> const char*
+    {
+        return m_data;
+    }
+
+    auto size() const -> std::size_t
+    {
+        return (m_data != nullptr) ? m_size : 0;
+    }
+
+    auto text() const -> std::string_view
+    {
+        return { m_data, size() };
+    }
+
+    // No copy.
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+private:
+
+    auto close() -> void;
+
+    int m_fd{ -1 };
+    const char* m_data{ nullptr };
+    std::size_t m_size{ 0 };
+};
+
+} // cgfs
@@ -0,0 +1,197 @@
+#include "mesh_cache.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace cgfs
+{
+
+// Size and modification time of the source asset, to detect stale caches.
+static auto get_source_state(const std::string& source_filename, MeshCacheHeader& header) -> bool
+{
+    std::error_code error{};
+
+    const auto size = std::filesystem::file_size(source_filename, error);
+    if (error)
+    {
+        return false;
+    }
+
+    const auto time = std::filesystem::last_write_time(source_filename, error);
+    if (error)
+    {
+        return false;
+    }
+
+    header.source_size = static_cast<std::uint64_t>(size);
+    header.source_time = static_cast<std::int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+static auto align_offset(const std::uint64_t offset) -> std::uint64_t
+{
+    return (offset + kMeshCacheAlignment - 1) & ~(kMeshCacheAlignment - 1);
+}
+
+// ========================================================
+// MeshCacheReader:
+// ========================================================
+
+MeshCacheReader::MeshCacheReader(const std::string& cache_filename, const MeshCacheKey& key)
+    : m_file{ cache_filename }
+{
+    MeshCacheHeader expected{ .layout = key.layout, .vertex_scale = key.vertex_scale };
+    if (!m_file.is_open() || m_file.size() < sizeof(MeshCacheHeader) || !get_source_state(key.source_filename, expected))
+    {
+        return;
+    }
+
+    MeshCacheHeader header{};
+    std::memcpy(&header, m_file.data(), sizeof(header));
+
+    if (header.magic != expected.magic ||
+        header.version != expected.version ||
+        header.layout != expected.layout ||
+        header.source_size != expected.source_size ||
+        header.source_time != expected.source_time ||
+        header.vertex_scale != expected.vertex_scale)
+    {
+        return;
+    }
+
+    // Reject truncated files.
+    const std::uint64_t table_end = sizeof(MeshCacheHeader) + (std::uint64_t{ header.chunk_count } * sizeof(MeshCacheChunk));
+    if (table_end > m_file.size())
+    {
+        return;
+    }
+
+    for (std::uint32_t i = 0; i < header.chunk_count; ++i)
+    {
+        MeshCacheChunk chunk{};
+        std::memcpy(&chunk, m_file.data() + sizeof(MeshCacheHeader) + (i * sizeof(MeshCacheChunk)), sizeof(chunk));
+
+        if (chunk.element_size == 0 || chunk.count > (m_file.size() / chunk.element_size) ||
+            chunk.offset > m_file.size() - (chunk.count * chunk.element_size))
+        {
+            return;
+        }
+    }
+
+    m_is_valid = true;
+}
+
+auto MeshCacheReader::find_chunk(const std::uint32_t id) const -> const MeshCacheChunk*
+{
+    if (!m_is_valid)
+    {
+        return nullptr;
+    }
+
+    const auto* const header = reinterpret_cast<const MeshCacheHeader*>(m_file.data());
+    const auto* const chunks = reinterpret_cast<const MeshCacheChunk*>(m_file.data() + sizeof(MeshCacheHeader));
+
+    for (std::uint32_t i = 0; i < header->chunk_count; ++i)
+    {
+        if (chunks[i].id == id)
+        {
+            return &chunks[i];
+        }
+    }
+
+    return nullptr;
+}
+
+// ========================================================
+// MeshCacheWriter:
+// ========================================================
+
+// "name.meshcache" => "name.<random hex>.meshcache.tmp"
+static auto unique_temp_filename(const std::string& cache_filename) -> std::string
+{
+    std::random_device random{};
+    const std::uint64_t suffix = (std::uint64_t{ random() } << 32) | random();
+
+    std::filesystem::path path{ cache_filename };
+    const std::string extension = path.extension().string();
+    path.replace_extension();
+
+    char suffix_hex[17]{};
+    std::snprintf(suffix_hex, sizeof(suffix_hex), "%016llx", static_cast<unsigned long long>(suffix));
+
+    return path.string() + "." + suffix_hex + extension + ".tmp";
+}
+
+auto MeshCacheWriter::write(const std::string& cache_filename, const MeshCacheKey& key) const -> bool
+{
+    MeshCacheHeader header{
+        .layout = key.layout,
+        .chunk_count = static_cast<std::uint32_t>(m_chunks.size()),
+        .vertex_scale = key.vertex_scale
+    };
+
+    if (!get_source_state(key.source_filename, header))
+    {
+        return false;
+    }
+
+    std::vector<MeshCacheChunk> chunk_table{};
+    chunk_table.reserve(m_chunks.size());
+
+    std::uint64_t offset = sizeof(MeshCacheHeader) + (m_chunks.size() * sizeof(MeshCacheChunk));
+    for (const PendingChunk& pending : m_chunks)
+    {
+        offset = align_offset(offset);
+        MeshCacheChunk& chunk = chunk_table.emplace_back(pending.chunk);
+        chunk.offset = offset;
+        offset += chunk.count * chunk.element_size;
+    }
+
+    // Written under a unique name then renamed, so concurrent imports of the same
+    // OBJ never write the same file and readers never see a partial cache.
+    const std::string temp_filename = unique_temp_filename(cache_filename);
+    {
+        std::ofstream file{ temp_filename, std::ios::binary | std::ios::trunc };
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(chunk_table.data()), chunk_table.size() * sizeof(MeshCacheChunk));
+
+        for (std::size_t i = 0; i < m_chunks.size(); ++i)
+        {
+            const MeshCacheChunk& chunk = chunk_table[i];
+
+            // Zero padding up to the chunk alignment.
+            const std::uint64_t padding = chunk.offset - static_cast<std::uint64_t>(file.tellp());
+            static constexpr char kZeros[kMeshCacheAlignment]{};
+            file.write(kZeros, static_cast<std::streamsize>(padding));
+
+            file.write(static_cast<const char*>(m_chunks[i].data), static_cast<std::streamsize>(chunk.count * chunk.element_size));
+        }
+
+        file.close();
+    }
+
+    std::error_code error{};
+    if (std::filesystem::file_size(temp_filename, error) != offset)
+    {
+        std::filesystem::remove(temp_filename, error);
+        return false;
+    }
+
+    std::filesystem::rename(temp_filename, cache_filename, error);
+    if (error)
+    {
+        std::filesystem::remove(temp_filename, error);
+        return false;
+    }
+
+    return true;
+}
+
+} // cgfs
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "mapped_file.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace cgfs
+{
+
+// Binary cache of an imported mesh, written next to its source asset so later runs
+// can load each mesh array with a single copy instead of parsing the source again.
+//
+// Layout: MeshCacheHeader, one MeshCacheChunk per array, then the arrays, each aligned to
+// kMeshCacheAlignment. Stored in native byte order, so caches are not portable between machines.
+// A cache is stale if the size or modification time of its source changed, or if it was
+// written by another cache version, mesh layout or vertex scale; stale caches are never read.
+constexpr std::uint64_t kMeshCacheAlignment = 64;
+
+struct MeshCacheHeader final
+{
+    static constexpr std::uint32_t kMagic = 0x4853454D; // "MESH"
+    static constexpr std::uint32_t kVersion = 2;
+
+    std::uint32_t magic{ kMagic };
+    std::uint32_t version{ kVersion };
+    std::uint32_t layout{ 0 }; // Tag of the mesh type the chunks belong to, chosen by its loader.
+    std::uint32_t chunk_count{ 0 };
+    std::uint64_t source_size{ 0 };
+    std::int64_t source_time{ 0 };
+    float vertex_scale{ 0.0f };
+    std::uint32_t padding{ 0 };
+};
+
+struct MeshCacheChunk final
+{
+    std::uint32_t id{ 0 };
+    std::uint32_t element_size{ 0 };
+    std::uint64_t offset{ 0 }; // From the start of the file.
+    std::uint64_t count{ 0 };
+};
+
+// What a cache must match to be up to date.
+struct MeshCacheKey final
+{
+    std::string source_filename{};
+    std::uint32_t layout{ 0 };
+    float vertex_scale{ 1.0f };
+};
+
+// Memory maps a cache file, if it is up to date.
+class MeshCacheReader final
+{
+public:
+
+    MeshCacheReader(const std::string& cache_filename, const MeshCacheKey& key);
+
+    auto is_valid() const -> bool
+    {
+        return m_is_valid;
+    }
+
+    // Copies chunk `id` into `out`. Fails if the chunk is missing or its elements have a different size.
+    template<typename T>
+    auto read(const std::uint32_t id, std::vector<T>& out) const -> bool
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        const MeshCacheChunk* const chunk = find_chunk(id);
+        if (chunk == nullptr || chunk->element_size != sizeof(T))
+        {
+            return false;
+        }
+
+        out.resize(chunk->count);
+        std::memcpy(out.data(), m_file.data() + chunk->offset, chunk->count * sizeof(T));
+        return true;
+    }
+
+private:
+
+    auto find_chunk(std::uint32_t id) const -> const MeshCacheChunk*;
+
+    MappedFile m_file;
+    bool m_is_valid{ false };
+};
+
+// Collects the mesh arrays of a cache file, then writes them at once.
+// Arrays are referenced, not copied, so they must outlive write().
+class MeshCacheWriter final
+{
+public:
+
+    template<typename T>
+    auto add(const std::uint32_t id, const std::span<const T> elements) -> void
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        m_chunks.push_back({
+            .chunk = { .id = id, .element_size = sizeof(T), .count = elements.size() },
+            .data = elements.data()
+        });
+    }
+
+    // Writes a temporary file that is then renamed over `cache_filename`,
+    // so readers never see a partially written cache.
+    auto write(const std::string& cache_filename, const MeshCacheKey& key) const -> bool;
+
+private:
+
+    struct PendingChunk final
+    {
+        MeshCacheChunk chunk{};
+        const void* data{ nullptr };
+    };
+
+    std::vector<PendingChunk> m_chunks{};
+};
+
+} // cgfs
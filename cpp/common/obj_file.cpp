@@ -0,0 +1,264 @@
+#include "obj_file.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+namespace cgfs
+{
+
+// ========================================================
+// Line parsing:
+// ========================================================
+
+static auto is_space(const char c) -> bool
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static auto skip_spaces(const char*& cursor, const char* const end) -> void
+{
+    while (cursor < end && is_space(*cursor))
+    {
+        ++cursor;
+    }
+}
+
+static auto parse_float(const char*& cursor, const char* const end, float& out) -> bool
+{
+    skip_spaces(cursor, end);
+
+    // from_chars() doesn't accept an explicit plus sign.
+    if (cursor < end && *cursor == '+')
+    {
+        ++cursor;
+    }
+
+    const auto [ptr, ec] = std::from_chars(cursor, end, out);
+    cursor = ptr;
+    return ec == std::errc{};
+}
+
+// OBJ indices are 1-based. Negative (relative) indices are not supported.
+static auto parse_index(const char*& cursor, const char* const end, std::uint32_t& out) -> bool
+{
+    std::uint32_t index = 0;
+
+    const auto [ptr, ec] = std::from_chars(cursor, end, index);
+    if (ec != std::errc{} || index == 0)
+    {
+        return false;
+    }
+
+    cursor = ptr;
+    out = index - 1;
+    return true;
+}
+
+// `vertex`, `vertex/tex_coord`, `vertex//normal` or `vertex/tex_coord/normal`.
+static auto parse_corner(const char*& cursor, const char* const end, ObjFile::Corner& corner) -> bool
+{
+    if (!parse_index(cursor, end, corner.vert))
+    {
+        return false;
+    }
+
+    if (cursor < end && *cursor == '/')
+    {
+        ++cursor;
+
+        if (cursor < end && *cursor != '/' && !parse_index(cursor, end, corner.tex_coord))
+        {
+            return false;
+        }
+
+        if (cursor < end && *cursor == '/')
+        {
+            ++cursor;
+
+            if (!parse_index(cursor, end, corner.normal))
+            {
+                return false;
+            }
+        }
+    }
+
+    return cursor == end || is_space(*cursor);
+}
+
+static auto parse_face(const char* cursor, const char* const end, ObjFile::Face& face) -> bool
+{
+    int count = 0;
+
+    for (skip_spaces(cursor, end); cursor < end; skip_spaces(cursor, end))
+    {
+        // Only support triangles (3 vertices per face).
+        if (count >= 3) [[unlikely]]
+        {
+            return false;
+        }
+
+        if (!parse_corner(cursor, end, face.corners[count]))
+        {
+            return false;
+        }
+
+        ++count;
+    }
+
+    return count == 3;
+}
+
+// Parses the lines in [begin, end) into `obj`. Unknown statements are ignored.
+static auto parse_lines(const char* const begin, const char* const end, const float vertex_scale, ObjFile& obj) -> bool
+{
+    for (const char* line = begin; line < end;)
+    {
+        const void* const newline = std::memchr(line, '\n', end - line);
+        const char* const line_end = (newline != nullptr) ? static_cast<const char*>(newline) : end;
+
+        const char* cursor = line;
+        skip_spaces(cursor, line_end);
+
+        const char* const keyword = cursor;
+        while (cursor < line_end && !is_space(*cursor))
+        {
+            ++cursor;
+        }
+
+        const std::string_view prefix{ keyword, cursor };
+        bool is_valid = true;
+
+        // Parse vertices (v)
+        if (prefix == "v")
+        {
+            Point3 v = {};
+            is_valid = parse_float(cursor, line_end, v.x) && parse_float(cursor, line_end, v.y) && parse_float(cursor, line_end, v.z);
+            obj.vertices.push_back(v * vertex_scale);
+        }
+        // Parse texture coordinates (vt)
+        else if (prefix == "vt")
+        {
+            TexCoords tc = {};
+            is_valid = parse_float(cursor, line_end, tc.u) && parse_float(cursor, line_end, tc.v);
+            obj.tex_coords.push_back(tc);
+        }
+        // Parse normals (vn)
+        else if (prefix == "vn")
+        {
+            Vec3 vn = {};
+            is_valid = parse_float(cursor, line_end, vn.x) && parse_float(cursor, line_end, vn.y) && parse_float(cursor, line_end, vn.z);
+            obj.normals.push_back(vn);
+        }
+        // Parse faces (f)
+        else if (prefix == "f")
+        {
+            ObjFile::Face face = {};
+            is_valid = parse_face(cursor, line_end, face);
+            obj.faces.push_back(face);
+        }
+
+        if (!is_valid) [[unlikely]]
+        {
+            std::println(stderr, "Invalid or non-triangle OBJ model line: `{}`", std::string_view{ line, line_end });
+            return false;
+        }
+
+        line = line_end + 1;
+    }
+
+    return true;
+}
+
+// ========================================================
+// load_obj_file():
+// ========================================================
+
+// Smallest chunk of a file parsed by one thread.
+constexpr std::size_t kParallelChunkSize = 4 * 1024 * 1024;
+
+template<typename T>
+static auto append(std::vector<T>& dest, const std::vector<T>& src) -> void
+{
+    dest.insert(dest.end(), src.begin(), src.end());
+}
+
+auto load_obj_file(ObjFile& obj, const std::string& filename, const float vertex_scale, ThreadPool* thread_pool) -> bool
+{
+    const MappedFile file{ filename };
+    if (!file.is_open())
+    {
+        std::println(stderr, "Error: Could not open file: '{}'", filename);
+        return false;
+    }
+
+    obj = {};
+
+    const std::string_view text = file.text();
+    const char* const begin = text.data();
+    const char* const end = text.data() + text.size();
+
+    const std::size_t max_chunks = (thread_pool != nullptr) ? std::size_t{ thread_pool->num_threads() } * 4 : 1;
+    const std::size_t chunk_count = std::clamp<std::size_t>(text.size() / kParallelChunkSize, 1, max_chunks);
+
+    if (chunk_count == 1)
+    {
+        return parse_lines(begin, end, vertex_scale, obj);
+    }
+
+    // Chunks split the file on line boundaries. Face indices are absolute,
+    // so chunks parse independently and are concatenated in file order.
+    std::vector<const char*> chunk_begins(chunk_count + 1, end);
+    chunk_begins[0] = begin;
+
+    for (std::size_t c = 1; c < chunk_count; ++c)
+    {
+        const char* const split = std::max(begin + (text.size() / chunk_count) * c, chunk_begins[c - 1]);
+        const void* const newline = std::memchr(split, '\n', end - split);
+        chunk_begins[c] = (newline != nullptr) ? static_cast<const char*>(newline) + 1 : end;
+    }
+
+    std::vector<ObjFile> chunks(chunk_count);
+    std::vector<std::uint8_t> is_parsed(chunk_count, 0);
+
+    thread_pool->parallel_for(static_cast<std::uint32_t>(chunk_count), [&](const std::uint32_t c, std::uint32_t) {
+        is_parsed[c] = parse_lines(chunk_begins[c], chunk_begins[c + 1], vertex_scale, chunks[c]);
+    });
+
+    if (std::ranges::find(is_parsed, 0) != is_parsed.end())
+    {
+        return false;
+    }
+
+    std::size_t vertex_count = 0;
+    std::size_t normal_count = 0;
+    std::size_t tex_coord_count = 0;
+    std::size_t face_count = 0;
+
+    for (const ObjFile& chunk : chunks)
+    {
+        vertex_count += chunk.vertices.size();
+        normal_count += chunk.normals.size();
+        tex_coord_count += chunk.tex_coords.size();
+        face_count += chunk.faces.size();
+    }
+
+    obj.vertices.reserve(vertex_count);
+    obj.normals.reserve(normal_count);
+    obj.tex_coords.reserve(tex_coord_count);
+    obj.faces.reserve(face_count);
+
+    for (const ObjFile& chunk : chunks)
+    {
+        append(obj.vertices, chunk.vertices);
+        append(obj.normals, chunk.normals);
+        append(obj.tex_coords, chunk.tex_coords);
+        append(obj.faces, chunk.faces);
+    }
+
+    return true;
+}
+
+} // cgfs
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "vec3.hpp"
+#include "texcoords.hpp"
+#include "thread_pool.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cgfs
+{
+
+// Contents of a Wavefront .obj file, shared by the rasterizer and raytracer mesh loaders.
+// Only triangle faces are supported. Indices are 0-based.
+struct ObjFile final
+{
+    static constexpr std::uint32_t kNoIndex = UINT32_MAX;
+
+    struct Corner final
+    {
+        std::uint32_t vert{ kNoIndex };
+        std::uint32_t tex_coord{ kNoIndex }; // Optional.
+        std::uint32_t normal{ kNoIndex };    // Optional.
+    };
+
+    struct Face final
+    {
+        Corner corners[3]{};
+    };
+
+    std::vector<Point3> vertices{}; // Already scaled.
+    std::vector<Vec3> normals{};
+    std::vector<TexCoords> tex_coords{}; // As stored in the file, V is not flipped.
+    std::vector<Face> faces{};
+};
+
+// Memory maps the file and parses it in place, without per-line allocations.
+// With a thread pool, large files are split in chunks of whole lines parsed in parallel.
+// Called from a task running on the same pool, it parses on the calling thread only.
+auto load_obj_file(ObjFile& obj, const std::string& filename, const float vertex_scale = 1.0f, ThreadPool* thread_pool = nullptr) -> bool;
+
+} // cgfs
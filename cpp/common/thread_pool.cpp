@@ -0,0 +1,193 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace cgfs
+{
+
+// Pool whose tasks the current thread is running, if any, and the thread's index in it.
+// Lets parallel_for() detect calls nested inside one of its own tasks.
+static thread_local const ThreadPool* t_running_pool{ nullptr };
+static thread_local std::uint32_t t_running_thread_idx{ 0 };
+
+ThreadPool::ThreadPool(const std::uint32_t num_threads)
+{
+    const std::uint32_t thread_count = (num_threads != 0) ? num_threads : hardware_threads();
+
+    m_queues.reserve(thread_count);
+    for (std::uint32_t i = 0; i < thread_count; ++i)
+    {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    // Thread 0 is whoever calls parallel_for().
+    m_workers.reserve(thread_count - 1);
+    for (std::uint32_t i = 1; i < thread_count; ++i)
+    {
+        m_workers.emplace_back([this, i]() { worker_main(i); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock{ m_mutex };
+        m_quit = true;
+    }
+    m_wake_cv.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+auto ThreadPool::hardware_threads() -> std::uint32_t
+{
+    // hardware_concurrency() is allowed to return 0 when unknown.
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+auto ThreadPool::parallel_for(const std::uint32_t count, const TaskFunc& func) -> void
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Nested call: m_submit_mutex is already held by the outer job, and waiting for it
+    // here would deadlock. The other threads are busy with the outer job anyway.
+    if (t_running_pool == this)
+    {
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            func(i, t_running_thread_idx);
+        }
+        return;
+    }
+
+    std::lock_guard submit_lock{ m_submit_mutex };
+
+    // Seed each queue with a contiguous run so neighboring items stay on the same thread
+    // unless stealing is needed. All queues are empty here since the previous job fully drained.
+    const auto thread_count = num_threads();
+    for (std::uint32_t t = 0; t < thread_count; ++t)
+    {
+        const std::uint32_t begin = static_cast<std::uint32_t>((std::uint64_t{ count } * t) / thread_count);
+        const std::uint32_t end = static_cast<std::uint32_t>((std::uint64_t{ count } * (t + 1)) / thread_count);
+
+        WorkQueue& queue = *m_queues[t];
+        std::lock_guard queue_lock{ queue.mutex };
+        assert(queue.items.empty());
+
+        for (std::uint32_t i = begin; i < end; ++i)
+        {
+            queue.items.push_back(i);
+        }
+    }
+
+    {
+        std::lock_guard lock{ m_mutex };
+        m_job = &func;
+        m_job_generation++;
+    }
+    m_wake_cv.notify_all();
+
+    run_tasks(func, 0);
+
+    // Queues are drained once the calling thread runs out of work to steal, but
+    // workers may still be finishing their last item and must not outlive `func`.
+    std::unique_lock lock{ m_mutex };
+    m_job = nullptr;
+    m_done_cv.wait(lock, [this]() { return m_busy_workers == 0; });
+}
+
+auto ThreadPool::worker_main(const std::uint32_t thread_idx) -> void
+{
+    std::uint64_t last_generation = 0;
+
+    for (;;)
+    {
+        const TaskFunc* job = nullptr;
+        {
+            std::unique_lock lock{ m_mutex };
+            m_wake_cv.wait(lock, [&]() { return m_quit || m_job_generation != last_generation; });
+
+            if (m_quit)
+            {
+                return;
+            }
+
+            last_generation = m_job_generation;
+
+            // Woke up after the job had already completed; nothing left to do.
+            if (m_job == nullptr)
+            {
+                continue;
+            }
+
+            job = m_job;
+            m_busy_workers++;
+        }
+
+        run_tasks(*job, thread_idx);
+
+        {
+            std::lock_guard lock{ m_mutex };
+            m_busy_workers--;
+        }
+        m_done_cv.notify_one();
+    }
+}
+
+auto ThreadPool::run_tasks(const TaskFunc& func, const std::uint32_t thread_idx) -> void
+{
+    // Saved and restored since a task may run jobs on another pool.
+    const ThreadPool* const prev_pool = t_running_pool;
+    const std::uint32_t prev_thread_idx = t_running_thread_idx;
+    t_running_pool = this;
+    t_running_thread_idx = thread_idx;
+
+    std::uint32_t item = 0;
+    while (pop_or_steal(thread_idx, item))
+    {
+        func(item, thread_idx);
+    }
+
+    t_running_pool = prev_pool;
+    t_running_thread_idx = prev_thread_idx;
+}
+
+auto ThreadPool::pop_or_steal(const std::uint32_t thread_idx, std::uint32_t& out_item) -> bool
+{
+    // Own queue first, taken from the front to preserve locality.
+    {
+        WorkQueue& own = *m_queues[thread_idx];
+        std::lock_guard lock{ own.mutex };
+        if (!own.items.empty())
+        {
+            out_item = own.items.front();
+            own.items.pop_front();
+            return true;
+        }
+    }
+
+    // Then steal from the back of the other queues, furthest from what their owner is working on.
+    const auto thread_count = num_threads();
+    for (std::uint32_t offset = 1; offset < thread_count; ++offset)
+    {
+        WorkQueue& victim = *m_queues[(thread_idx + offset) % thread_count];
+        std::lock_guard lock{ victim.mutex };
+        if (!victim.items.empty())
+        {
+            out_item = victim.items.back();
+            victim.items.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // cgfs
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cgfs
+{
+
+// Persistent pool of worker threads with per-thread work-stealing queues.
+// The thread calling parallel_for() also takes part in the work, so a pool of
+// N threads spawns N-1 workers. Workers sleep between jobs and live until the pool is destroyed.
+class ThreadPool final
+{
+public:
+
+    // Work item callback: (index in [0, count), index of the thread running it in [0, num_threads())).
+    using TaskFunc = std::function<void(std::uint32_t, std::uint32_t)>;
+
+    // 0 = one thread per hardware core.
+    explicit ThreadPool(std::uint32_t num_threads = 0);
+    ~ThreadPool();
+
+    // Runs func(i, thread_idx) for every i in [0, count) and blocks until all are done.
+    // Indices are split into contiguous runs, one per thread; threads that run out
+    // of work steal from the back of the other queues, so uneven item costs still balance.
+    // A call made from a task already running on this pool can't hand work to the other
+    // threads, which are busy with the outer job, so it runs every item inline on the
+    // calling thread instead, with that thread's index.
+    auto parallel_for(std::uint32_t count, const TaskFunc& func) -> void;
+
+    // Total threads that run work, including the calling thread.
+    auto num_threads() const -> std::uint32_t { return static_cast<std::uint32_t>(m_queues.size()); }
+
+    static auto hardware_threads() -> std::uint32_t;
+
+    // No copy.
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+private:
+
+    struct WorkQueue final
+    {
+        std::mutex mutex{};
+        std::deque<std::uint32_t> items{};
+    };
+
+    auto worker_main(std::uint32_t thread_idx) -> void;
+    auto run_tasks(const TaskFunc& func, std::uint32_t thread_idx) -> void;
+    auto pop_or_steal(std::uint32_t thread_idx, std::uint32_t& out_item) -> bool;
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues{}; // One per thread; [0] belongs to the caller.
+    std::vector<std::thread> m_workers{};
+
+    std::mutex m_submit_mutex{}; // Serializes parallel_for() calls from different threads.
+    std::mutex m_mutex{};
+    std::condition_variable m_wake_cv{};
+    std::condition_variable m_done_cv{};
+
+    const TaskFunc* m_job{ nullptr };
+    std::uint64_t m_job_generation{ 0 };
+    std::uint32_t m_busy_workers{ 0 };
+    bool m_quit{ false };
+};
+
+} // cgfs
@@ -57,4 +57,42 @@ struct Dims final
     }
 };
 
+// Rectangle of pixels in screen coordinates (origin at the top-left corner).
+// x = [x, x + width)
+// y = [y, y + height)
+struct ScreenRect final
+{
+    int x{ 0 };
+    int y{ 0 };
+    int width{ 0 };
+    int height{ 0 };
+
+    auto contains(const ScreenRect& other) const -> bool
+    {
+        return other.x >= x && other.x + other.width <= x + width &&
+               other.y >= y && other.y + other.height <= y + height;
+    }
+};
+
+// Copies the pixels of `rect` between two row-major buffers, each storing
+// its own window of the same image. `rect` must be inside both windows.
+template<typename T>
+inline auto copy_window_pixels(const T* src, const ScreenRect& src_window,
+                               T* dst, const ScreenRect& dst_window,
+                               const ScreenRect& rect) -> void
+{
+    assert(src_window.contains(rect) && dst_window.contains(rect));
+
+    for (int y = rect.y; y < rect.y + rect.height; ++y)
+    {
+        const T* src_row = src + (rect.x - src_window.x) + ((y - src_window.y) * src_window.width);
+        T* dst_row = dst + (rect.x - dst_window.x) + ((y - dst_window.y) * dst_window.width);
+
+        for (int x = 0; x < rect.width; ++x)
+        {
+            dst_row[x] = src_row[x];
+        }
+    }
+}
+
 } // cfg
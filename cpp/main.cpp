@@ -22,6 +22,10 @@ auto main([[maybe_unused]] const int argc,
           [[maybe_unused]] const char* argv[]) -> int
 {
     print_working_dir();
-    raytracer_demo();
-    rasterizer_demo();
+
+    // Shared by both demos so worker threads are only spawned once.
+    cgfs::ThreadPool thread_pool{};
+
+    raytracer_demo(thread_pool);
+    rasterizer_demo(thread_pool);
 }
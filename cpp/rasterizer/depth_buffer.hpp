@@ -1,66 +1,294 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 
 namespace cgfs::rasterizer
 {
 
+// Stores 1/z per pixel, so 0 (the cleared value) is infinitely far and larger values are closer.
+// Also keeps a two level hierarchical Z: the minimum 1/z of each kHiZTileSize^2 pixel tile and of
+// each block of kHiZTileSize^2 tiles. is_occluded() uses it to reject whole triangles, spans or
+// tiles that can't pass a single depth test, without reading the individual pixels.
+// Optionally records the ID of the face that passed the last test of each pixel (visibility buffer).
 class DepthBuffer final
 {
 public:
-    
+
+    static constexpr int kHiZTileSize = 8;
+    static constexpr std::uint32_t kNoFaceId = ~std::uint32_t{ 0 };
+
     explicit DepthBuffer(const Dims dimensions)
         : m_dimensions{ dimensions }
+        , m_window{ 0, 0, dimensions.width, dimensions.height }
     {
         assert(m_dimensions.is_valid());
         m_buffer.resize(m_dimensions.width * m_dimensions.height, 0.0f);
+        init_hiz();
+    }
+
+    // Slice storing only the depth values inside `window`; see the Canvas slice constructor.
+    DepthBuffer(const Dims dimensions, const ScreenRect& window)
+        : m_dimensions{ dimensions }
+        , m_window{ window }
+    {
+        assert(m_dimensions.is_valid());
+        assert((ScreenRect{ 0, 0, dimensions.width, dimensions.height }.contains(m_window)));
+        m_buffer.resize(m_window.width * m_window.height, 0.0f);
+        init_hiz();
     }
 
     // Origin (0,0) is at the center (same as the canvas).
     // x = [-buffer.w/2, buffer.w/2]
     // y = [-buffer.h/2, buffer.h/2]
     // Returns: true if current Z is lower and new value was written, false if existing Z is higher.
-    auto test_and_set(const Point2 point, const float inv_z) -> bool
+    // If face IDs are enabled, `face_id` is also recorded as the face visible at the pixel.
+    auto test_and_set(const Point2 point, const float inv_z, const std::uint32_t face_id = kNoFaceId) -> bool
     {
-        // Map back to "screen" coords with origin at the top-left corner.
-        const auto x = ((m_dimensions.width  / 2) + point.x);
-        const auto y = ((m_dimensions.height / 2) - point.y - 1);
+        // Map back to "screen" coords with origin at the top-left corner, then into the window.
+        const auto x = ((m_dimensions.width  / 2) + point.x) - m_window.x;
+        const auto y = ((m_dimensions.height / 2) - point.y - 1) - m_window.y;
 
-        if (x < 0 || x >= m_dimensions.width ||
-            y < 0 || y >= m_dimensions.height) [[unlikely]]
+        if (x < 0 || x >= m_window.width ||
+            y < 0 || y >= m_window.height) [[unlikely]]
         {
             return false;
         }
         
-        const std::size_t buffer_idx = x + (y * m_dimensions.width);
+        const std::size_t buffer_idx = x + (y * m_window.width);
         assert(buffer_idx < m_buffer.size());
 
         if (m_buffer[buffer_idx] < inv_z)
         {
             m_buffer[buffer_idx] = inv_z;
+            mark_hiz_dirty(x, y);
+
+            if (!m_face_ids.empty())
+            {
+                m_face_ids[buffer_idx] = face_id;
+            }
             return true;
         }
         
         return false;
     }
 
+    // Enables face IDs on first use and sets every pixel back to kNoFaceId.
+    auto reset_face_ids() -> void
+    {
+        m_face_ids.assign(m_buffer.size(), kNoFaceId);
+    }
+
+    // Face recorded by the last test_and_set() that passed at the pixel.
+    // kNoFaceId if none, if the point is outside of the buffer or if face IDs are not enabled.
+    auto face_id(const Point2 point) const -> std::uint32_t
+    {
+        const auto x = ((m_dimensions.width  / 2) + point.x) - m_window.x;
+        const auto y = ((m_dimensions.height / 2) - point.y - 1) - m_window.y;
+
+        if (m_face_ids.empty() ||
+            x < 0 || x >= m_window.width ||
+            y < 0 || y >= m_window.height) [[unlikely]]
+        {
+            return kNoFaceId;
+        }
+
+        return m_face_ids[x + (y * m_window.width)];
+    }
+
+    // True if no pixel of the canvas rectangle [min, max] can pass test_and_set() with a value
+    // up to `max_inv_z`, the largest 1/z a primitive covering it can have. Also true if the
+    // rectangle is outside of the buffer. Conservative: false doesn't mean a test will pass.
+    auto is_occluded(const Point2 min, const Point2 max, const float max_inv_z) -> bool
+    {
+        // Interpolated values can overshoot the exact maximum by a rounding error.
+        const float test_inv_z = max_inv_z * (1.0f + kHiZTolerance);
+
+        // Screen y grows downwards; see test_and_set().
+        const int x0 = std::max(((m_dimensions.width / 2) + min.x) - m_window.x, 0);
+        const int x1 = std::min(((m_dimensions.width / 2) + max.x) - m_window.x, m_window.width - 1);
+        const int y0 = std::max(((m_dimensions.height / 2) - max.y - 1) - m_window.y, 0);
+        const int y1 = std::min(((m_dimensions.height / 2) - min.y - 1) - m_window.y, m_window.height - 1);
+
+        if (x0 > x1 || y0 > y1)
+        {
+            return true;
+        }
+
+        // A minimum over a larger area is still a lower bound for any part of it,
+        // so the coarse level is tested first and only the tiles of blocks that fail are refined.
+        const int tx0 = x0 / kHiZTileSize;
+        const int tx1 = x1 / kHiZTileSize;
+        const int ty0 = y0 / kHiZTileSize;
+        const int ty1 = y1 / kHiZTileSize;
+
+        for (int by = ty0 / kHiZTileSize; by <= ty1 / kHiZTileSize; ++by)
+        {
+            for (int bx = tx0 / kHiZTileSize; bx <= tx1 / kHiZTileSize; ++bx)
+            {
+                if (block_min(bx, by) >= test_inv_z)
+                {
+                    continue;
+                }
+
+                const int block_tx0 = std::max(tx0, bx * kHiZTileSize);
+                const int block_tx1 = std::min(tx1, (bx * kHiZTileSize) + kHiZTileSize - 1);
+                const int block_ty0 = std::max(ty0, by * kHiZTileSize);
+                const int block_ty1 = std::min(ty1, (by * kHiZTileSize) + kHiZTileSize - 1);
+
+                for (int ty = block_ty0; ty <= block_ty1; ++ty)
+                {
+                    for (int tx = block_tx0; tx <= block_tx1; ++tx)
+                    {
+                        if (tile_min(tx, ty) < test_inv_z)
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
     auto clear() -> void
     {
         std::fill(m_buffer.begin(), m_buffer.end(), 0.0f);
+        std::fill(m_tile_min.begin(), m_tile_min.end(), 0.0f);
+        std::fill(m_block_min.begin(), m_block_min.end(), 0.0f);
+        std::fill(m_tile_dirty.begin(), m_tile_dirty.end(), 0);
+        std::fill(m_block_dirty.begin(), m_block_dirty.end(), 0);
+        std::fill(m_face_ids.begin(), m_face_ids.end(), kNoFaceId);
+    }
+
+    // Copies the depth values inside this buffer's window from/to a buffer covering it.
+    // Face IDs are not copied.
+    auto copy_window_from(const DepthBuffer& source) -> void
+    {
+        copy_window_pixels(source.m_buffer.data(), source.m_window, m_buffer.data(), m_window, m_window);
+        std::fill(m_tile_dirty.begin(), m_tile_dirty.end(), 1);
+        std::fill(m_block_dirty.begin(), m_block_dirty.end(), 1);
+    }
+
+    auto copy_window_to(DepthBuffer& dest) const -> void
+    {
+        copy_window_pixels(m_buffer.data(), m_window, dest.m_buffer.data(), dest.m_window, m_window);
+
+        const int x = m_window.x - dest.m_window.x;
+        const int y = m_window.y - dest.m_window.y;
+        for (int ty = y / kHiZTileSize; ty <= (y + m_window.height - 1) / kHiZTileSize; ++ty)
+        {
+            for (int tx = x / kHiZTileSize; tx <= (x + m_window.width - 1) / kHiZTileSize; ++tx)
+            {
+                dest.mark_hiz_dirty(tx * kHiZTileSize, ty * kHiZTileSize);
+            }
+        }
     }
     
     auto width() const -> int { return m_dimensions.width; }
     auto height() const -> int { return m_dimensions.height; }
     auto dimensions() const -> Dims { return m_dimensions; }
+    auto window() const -> const ScreenRect& { return m_window; }
 
     // No copy.
     DepthBuffer(const DepthBuffer& other) = delete;
     DepthBuffer& operator=(const DepthBuffer& other) = delete;
     
 private:
-    
+
+    // Relative to max_inv_z; see is_occluded().
+    static constexpr float kHiZTolerance = 1e-3f;
+
+    auto init_hiz() -> void
+    {
+        m_tiles_x = (m_window.width + kHiZTileSize - 1) / kHiZTileSize;
+        m_tiles_y = (m_window.height + kHiZTileSize - 1) / kHiZTileSize;
+        m_blocks_x = (m_tiles_x + kHiZTileSize - 1) / kHiZTileSize;
+        m_blocks_y = (m_tiles_y + kHiZTileSize - 1) / kHiZTileSize;
+
+        m_tile_min.resize(m_tiles_x * m_tiles_y, 0.0f);
+        m_tile_dirty.resize(m_tiles_x * m_tiles_y, 0);
+        m_block_min.resize(m_blocks_x * m_blocks_y, 0.0f);
+        m_block_dirty.resize(m_blocks_x * m_blocks_y, 0);
+    }
+
+    // Minimums are refreshed lazily: writes only flag the tile and block containing the pixel.
+    // Depth values only ever increase, so a stale minimum is still a valid lower bound until then.
+    auto mark_hiz_dirty(const int x, const int y) -> void
+    {
+        const int tx = x / kHiZTileSize;
+        const int ty = y / kHiZTileSize;
+        m_tile_dirty[tx + (ty * m_tiles_x)] = 1;
+        m_block_dirty[(tx / kHiZTileSize) + ((ty / kHiZTileSize) * m_blocks_x)] = 1;
+    }
+
+    auto tile_min(const int tx, const int ty) -> float
+    {
+        const std::size_t tile_idx = tx + (ty * m_tiles_x);
+        if (m_tile_dirty[tile_idx])
+        {
+            const int x0 = tx * kHiZTileSize;
+            const int y0 = ty * kHiZTileSize;
+            const int x1 = std::min(x0 + kHiZTileSize, m_window.width);
+            const int y1 = std::min(y0 + kHiZTileSize, m_window.height);
+
+            float min_inv_z = m_buffer[x0 + (y0 * m_window.width)];
+            for (int y = y0; y < y1; ++y)
+            {
+                for (int x = x0; x < x1; ++x)
+                {
+                    min_inv_z = std::min(min_inv_z, m_buffer[x + (y * m_window.width)]);
+                }
+            }
+
+            m_tile_min[tile_idx] = min_inv_z;
+            m_tile_dirty[tile_idx] = 0;
+        }
+        return m_tile_min[tile_idx];
+    }
+
+    auto block_min(const int bx, const int by) -> float
+    {
+        const std::size_t block_idx = bx + (by * m_blocks_x);
+        if (m_block_dirty[block_idx])
+        {
+            const int tx0 = bx * kHiZTileSize;
+            const int ty0 = by * kHiZTileSize;
+            const int tx1 = std::min(tx0 + kHiZTileSize, m_tiles_x);
+            const int ty1 = std::min(ty0 + kHiZTileSize, m_tiles_y);
+
+            float min_inv_z = tile_min(tx0, ty0);
+            for (int ty = ty0; ty < ty1; ++ty)
+            {
+                for (int tx = tx0; tx < tx1; ++tx)
+                {
+                    min_inv_z = std::min(min_inv_z, tile_min(tx, ty));
+                }
+            }
+
+            m_block_min[block_idx] = min_inv_z;
+            m_block_dirty[block_idx] = 0;
+        }
+        return m_block_min[block_idx];
+    }
+
     const Dims m_dimensions{};
+    const ScreenRect m_window{}; // Part of the buffer stored in m_buffer.
     std::vector<float> m_buffer{};
+
+    // Hierarchical Z, over the window. Tiles are kHiZTileSize pixels wide, blocks kHiZTileSize tiles wide.
+    int m_tiles_x{ 0 };
+    int m_tiles_y{ 0 };
+    int m_blocks_x{ 0 };
+    int m_blocks_y{ 0 };
+    std::vector<float> m_tile_min{};
+    std::vector<float> m_block_min{};
+    std::vector<std::uint8_t> m_tile_dirty{};
+    std::vector<std::uint8_t> m_block_dirty{};
+
+    std::vector<std::uint32_t> m_face_ids{}; // Empty unless enabled by reset_face_ids().
 };
 
 } // cgfs::rasterizer
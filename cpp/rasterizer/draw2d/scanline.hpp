@@ -0,0 +1,160 @@
+#pragma once
+
+#include "../../common/canvas.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+
+// Helpers of the scanline triangle rasterizer; see draw_triangle_scanline() in tris.hpp.
+
+namespace cgfs::rasterizer
+{
+
+// ========================================================
+// Interpolation helpers:
+// ========================================================
+
+// Conditional cast:
+// - for int type, cast to float.
+// - for anything else, do nothing.
+template<typename T>
+inline auto to_float(const T& v) -> T
+{
+    return v;
+}
+
+inline auto to_float(const int i) -> float
+{
+    return static_cast<float>(i);
+}
+
+// Linear interpolation (DDA) from `v0` at `i0` to `v1` at `i1`.
+// Each next() call returns the value at the current step and moves to the following one,
+// so edges and scanlines of any length are walked without storing the interpolated values.
+// Values are computed from the step index rather than accumulated, so skipping steps
+// gives exactly the same values as walking them.
+template<typename T>
+class Interpolator final
+{
+    using ValueType = decltype(to_float(std::declval<T>()));
+
+public:
+
+    Interpolator(const int i0, const T v0, const int i1, const T v1)
+        : m_value0{ to_float(v0) }
+        , m_step{ (i0 != i1) ? (to_float(v1 - v0) / to_float(i1 - i0)) : ValueType{} }
+    {
+    }
+
+    auto next() -> T
+    {
+        const T value = T(m_value0 + (m_step * static_cast<float>(m_index)));
+        ++m_index;
+        return value;
+    }
+
+    auto skip(const int count) -> void
+    {
+        m_index += count;
+    }
+
+private:
+
+    ValueType m_value0;
+    ValueType m_step;
+    int m_index{ 0 };
+};
+
+enum class LeftSide : int
+{
+    k02, k01_12
+};
+
+// Which side of a triangle sorted from bottom to top is on the left:
+// the long edge p0-p2, or the two short edges p0-p1 and p1-p2.
+inline auto find_left_side(const Point2 p0, const Point2 p1, const Point2 p2) -> LeftSide
+{
+    // The sign of the cross product tells which side of the long edge p1 is on.
+    const std::int64_t cross = (static_cast<std::int64_t>(p2.x - p0.x) * (p1.y - p0.y)) -
+                               (static_cast<std::int64_t>(p1.x - p0.x) * (p2.y - p0.y));
+
+    if (cross == 0) // Degenerate; all points on a line.
+    {
+        return (p0.x < p1.x) ? LeftSide::k02 : LeftSide::k01_12;
+    }
+
+    return (cross < 0) ? LeftSide::k02 : LeftSide::k01_12;
+}
+
+// Interpolates a vertex attribute along the left and right edges of a triangle sorted from
+// bottom to top, one scanline at a time starting at p0.y. The short side switches from the
+// p0-p1 edge to the p1-p2 edge at p1.y.
+template<typename T>
+class ScanlineEdges final
+{
+public:
+
+    ScanlineEdges(const Point2 p0,
+                  const Point2 p1,
+                  const Point2 p2,
+                  const T a0,
+                  const T a1,
+                  const T a2,
+                  const LeftSide left_side)
+        : m_edge02{ p0.y, a0, p2.y, a2 }
+        , m_edge01{ p0.y, a0, p1.y, a1 }
+        , m_edge12{ p1.y, a1, p2.y, a2 }
+        , m_rows_below_p1{ p1.y - p0.y }
+        , m_left_side{ left_side }
+    {
+    }
+
+    // Left and right values of the current scanline; moves up to the next one.
+    auto next_row() -> std::pair<T, T>
+    {
+        const T long_value = m_edge02.next();
+        const T short_value = (m_rows_below_p1 > 0) ? m_edge01.next() : m_edge12.next();
+        --m_rows_below_p1;
+
+        if (m_left_side == LeftSide::k02)
+        {
+            return { long_value, short_value };
+        }
+        return { short_value, long_value };
+    }
+
+    // Moves up `count` scanlines without computing them.
+    auto skip_rows(const int count) -> void
+    {
+        const int rows_on_01 = std::clamp(m_rows_below_p1, 0, count);
+        m_edge02.skip(count);
+        m_edge01.skip(rows_on_01);
+        m_edge12.skip(count - rows_on_01);
+        m_rows_below_p1 -= count;
+    }
+
+private:
+
+    Interpolator<T> m_edge02;
+    Interpolator<T> m_edge01;
+    Interpolator<T> m_edge12;
+    int m_rows_below_p1;
+    const LeftSide m_left_side;
+};
+
+// ========================================================
+// Vertex sorting:
+// ========================================================
+
+// Sorts the vertices of a triangle from bottom to top (lowest point.y first).
+template<typename Vertex>
+inline auto sort_vertices_by_y(std::array<Vertex, 3>& verts) -> void
+{
+    if (verts[1].point.y < verts[0].point.y) { std::swap(verts[0], verts[1]); }
+    if (verts[2].point.y < verts[0].point.y) { std::swap(verts[0], verts[2]); }
+    if (verts[2].point.y < verts[1].point.y) { std::swap(verts[1], verts[2]); }
+}
+
+} // cgfs::rasterizer
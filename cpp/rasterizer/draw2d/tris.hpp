@@ -3,11 +3,325 @@
 #include "../../common/canvas.hpp"
 #include "../depth_buffer.hpp"
 #include "../texture.hpp"
-#include <functional>
+#include "scanline.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <type_traits>
 
 namespace cgfs::rasterizer
 {
 
+// ===============
+// TRIANGLE STATE:
+// ===============
+
+enum class TriangleShading : int
+{
+    kNone,      // Triangle or texture color only.
+    kIntensity, // Interpolated light intensity (flat and Gouraud shading).
+    kPhong      // Interpolated normal, lighting computed per pixel.
+};
+
+// What a triangle fill writes. The last two are the passes of deferred shading, which
+// shades each pixel once: depth and IDs of all triangles first, then the visible pixels.
+enum class TrianglePass : int
+{
+    kColor,       // Depth test (if enabled) and color every pixel that passes.
+    kVisibility,  // Depth test and record the triangle ID; no color. Requires depth testing.
+    kShadeVisible // Color the pixels where the triangle ID was recorded; no depth writes.
+};
+
+// Options of a triangle fill. Passed as a template argument, so every combination gets
+// its own pixel loop with no runtime switches. A new option is a new field here instead
+// of another copy of each triangle function.
+struct TriangleState final
+{
+    TriangleShading shading{ TriangleShading::kNone };
+    bool textured{ false };     // Texture color instead of the triangle color.
+    bool depth_tested{ false }; // Depth test with inverse Z; also makes texturing perspective correct.
+    TrianglePass pass{ TrianglePass::kColor };
+};
+
+// Per-vertex inputs. Only the attributes used by the TriangleState need to be set.
+struct RasterVertex final
+{
+    Point2 point{};
+    float z{ 1.0f };
+    float intensity{ 1.0f };
+    Vec3 normal{};
+    TexCoords tex_coords{};
+};
+
+struct RasterTriangle final
+{
+    std::array<RasterVertex, 3> verts{};
+    Color color{};
+    const Texture* texture{ nullptr }; // Required if the TriangleState is textured.
+    std::uint32_t id{ DepthBuffer::kNoFaceId }; // For the deferred shading passes.
+};
+
+// Screen space derivatives of a textured triangle's texture coordinates, which pick the mipmap
+// level of each pixel. The interpolated values, the texture coordinates divided by Z and 1/z
+// when depth tested, are linear in screen space, so their derivatives are constant over the triangle.
+struct TexCoordGradients final
+{
+    TexCoords ddx{};
+    TexCoords ddy{};
+    float inv_z_ddx{ 0.0f };
+    float inv_z_ddy{ 0.0f };
+
+    TexCoordGradients(const Point2 p0, const Point2 p1, const Point2 p2,
+                      const TexCoords t0, const TexCoords t1, const TexCoords t2,
+                      const float inv_z0, const float inv_z1, const float inv_z2)
+    {
+        const std::int64_t dx1 = static_cast<std::int64_t>(p1.x) - p0.x;
+        const std::int64_t dy1 = static_cast<std::int64_t>(p1.y) - p0.y;
+        const std::int64_t dx2 = static_cast<std::int64_t>(p2.x) - p0.x;
+        const std::int64_t dy2 = static_cast<std::int64_t>(p2.y) - p0.y;
+
+        const std::int64_t area = (dx1 * dy2) - (dx2 * dy1);
+        if (area == 0)
+        {
+            return; // Degenerate; sampled at full resolution.
+        }
+
+        // Solves a0 + ddx * (x - p0.x) + ddy * (y - p0.y) = a1, a2 at p1 and p2.
+        const float inv_area = 1.0f / static_cast<float>(area);
+        const auto fx1 = static_cast<float>(dx1);
+        const auto fy1 = static_cast<float>(dy1);
+        const auto fx2 = static_cast<float>(dx2);
+        const auto fy2 = static_cast<float>(dy2);
+
+        ddx = (((t1 - t0) * fy2) - ((t2 - t0) * fy1)) * inv_area;
+        ddy = (((t2 - t0) * fx1) - ((t1 - t0) * fx2)) * inv_area;
+        inv_z_ddx = (((inv_z1 - inv_z0) * fy2) - ((inv_z2 - inv_z0) * fy1)) * inv_area;
+        inv_z_ddy = (((inv_z2 - inv_z0) * fx1) - ((inv_z1 - inv_z0) * fx2)) * inv_area;
+    }
+
+    // Level of detail of the pixel with the final (perspective correct) `tex_coords` and its `inv_z`.
+    auto level_of_detail(const Texture& texture, const TexCoords tex_coords, const float inv_z) const -> float
+    {
+        // Quotient rule on tex_coords = (tex_coords / z) / (1 / z).
+        const TexCoords pixel_ddx = (ddx - (tex_coords * inv_z_ddx)) / inv_z;
+        const TexCoords pixel_ddy = (ddy - (tex_coords * inv_z_ddy)) / inv_z;
+        return texture.level_of_detail(pixel_ddx, pixel_ddy);
+    }
+};
+
+// Samples the triangle's texture at a pixel, with the mipmap level picked from the gradients.
+// `inv_z` is 1 for triangles that aren't depth tested.
+inline auto sample_triangle_texture(const RasterTriangle& triangle,
+                                    const TexCoordGradients& gradients,
+                                    const TexCoords tex_coords,
+                                    const float inv_z) -> Color
+{
+    const Texture& texture = *triangle.texture;
+    const float lod = texture.has_mipmaps() ? gradients.level_of_detail(texture, tex_coords, inv_z) : 0.0f;
+    return texture.sample_texel(tex_coords, lod);
+}
+
+// Given a point and a normal, compute and return the light intensity for it.
+// The triangle functions take it as a template parameter rather than through a type-erased
+// wrapper, so the lighting code is inlined into the span loop. Any callable with this
+// signature can be used as the pixel shader, not only the built-in light model.
+template<typename Func>
+concept PhongLightingFunc = std::is_invocable_r_v<float, Func, Point3, Vec3>;
+
+// Lighting function for triangles not using TriangleShading::kPhong.
+struct NoLighting final
+{
+    auto operator()(const Point3, const Vec3) const -> float { return 1.0f; }
+};
+
+// Per-pixel visibility test of a depth tested triangle, according to its pass.
+template<TriangleState kState>
+inline auto test_pixel_depth(DepthBuffer& depth_buffer, const Point2 point, const float inv_z, const std::uint32_t id) -> bool
+{
+    if constexpr (kState.pass == TrianglePass::kShadeVisible)
+    {
+        return depth_buffer.face_id(point) == id;
+    }
+    else
+    {
+        return depth_buffer.test_and_set(point, inv_z, id);
+    }
+}
+
+// =========
+// SCANLINE:
+// =========
+
+// Fills the triangle one horizontal segment at a time, interpolating the attributes along the
+// left and right edges and then across each segment. All the color filled, textured and shaded
+// triangle functions below are instances of it. `depth_buffer` is only used if depth tested.
+template<TriangleState kState, PhongLightingFunc LightingFunc>
+auto draw_triangle_scanline(Canvas& canvas,
+                            DepthBuffer* depth_buffer,
+                            const RasterTriangle& triangle,
+                            LightingFunc&& compute_lighting_fn) -> void
+{
+    assert(!kState.textured || triangle.texture != nullptr);
+    assert(!kState.depth_tested || depth_buffer != nullptr);
+    static_assert(kState.depth_tested || kState.pass == TrianglePass::kColor, "Deferred shading passes need depth testing.");
+
+    // Sort points from bottom to top.
+    std::array<RasterVertex, 3> verts = triangle.verts;
+    sort_vertices_by_y(verts);
+
+    const auto& [v0, v1, v2] = verts;
+    const Point2 p0 = v0.point;
+    const Point2 p1 = v1.point;
+    const Point2 p2 = v2.point;
+
+    if constexpr (kState.shading == TriangleShading::kIntensity)
+    {
+        assert(is_normalized(v0.intensity) && is_normalized(v1.intensity) && is_normalized(v2.intensity));
+    }
+
+    if constexpr (kState.depth_tested)
+    {
+        // Skip triangles behind what's already drawn. 1/z is linear in screen space, so its
+        // maximum is at a vertex. X is padded by the pixel edge stepping can round past the vertices.
+        const float max_inv_z = std::max({ 1.0f / v0.z, 1.0f / v1.z, 1.0f / v2.z });
+        const Point2 min_pt{ std::min({ p0.x, p1.x, p2.x }) - 1, p0.y };
+        const Point2 max_pt{ std::max({ p0.x, p1.x, p2.x }) + 1, p2.y };
+
+        if (depth_buffer->is_occluded(min_pt, max_pt, max_inv_z))
+        {
+            return;
+        }
+    }
+
+    // Perspective correct texture mapping (divide by Z) when depth values are available.
+    const auto tex_coords_of = [](const RasterVertex& v) -> TexCoords
+    {
+        return kState.depth_tested ? v.tex_coords / v.z : v.tex_coords;
+    };
+
+    const auto inv_z_of = [](const RasterVertex& v) -> float
+    {
+        return kState.depth_tested ? 1.0f / v.z : 1.0f;
+    };
+
+    // Only read for textures with mipmaps.
+    const TexCoordGradients tex_gradients{
+        p0, p1, p2,
+        tex_coords_of(v0), tex_coords_of(v1), tex_coords_of(v2),
+        inv_z_of(v0), inv_z_of(v1), inv_z_of(v2)
+    };
+
+    // Compute attribute values at the edges (note that we use the inverse Z values here).
+    // Attributes not used by the state are never read, so the compiler drops them.
+    const LeftSide left_side = find_left_side(p0, p1, p2);
+    ScanlineEdges<int> x_edges{ p0, p1, p2, p0.x, p1.x, p2.x, left_side };
+    ScanlineEdges<float> z_edges{ p0, p1, p2, 1.0f / v0.z, 1.0f / v1.z, 1.0f / v2.z, left_side };
+    ScanlineEdges<float> i_edges{ p0, p1, p2, v0.intensity, v1.intensity, v2.intensity, left_side };
+    ScanlineEdges<Vec3> n_edges{ p0, p1, p2, v0.normal, v1.normal, v2.normal, left_side };
+    ScanlineEdges<TexCoords> t_edges{ p0, p1, p2, tex_coords_of(v0), tex_coords_of(v1), tex_coords_of(v2), left_side };
+
+    // Only rows and columns inside the canvas window are visited, so triangles reaching
+    // far outside of it cost no more than their visible part; see Canvas::window().
+    const Point2 window_min = canvas.window_min();
+    const Point2 window_max = canvas.window_max();
+    const int first_row = std::max(p0.y, window_min.y);
+    const int last_row = std::min(p2.y, window_max.y);
+
+    if (first_row > p0.y)
+    {
+        const int skipped_rows = first_row - p0.y;
+        x_edges.skip_rows(skipped_rows);
+        z_edges.skip_rows(skipped_rows);
+        i_edges.skip_rows(skipped_rows);
+        n_edges.skip_rows(skipped_rows);
+        t_edges.skip_rows(skipped_rows);
+    }
+
+    // Draw horizontal segments.
+    for (int y = first_row; y <= last_row; ++y)
+    {
+        const auto [xl, xr] = x_edges.next_row();
+        const auto [zl, zr] = z_edges.next_row();
+        const auto [il, ir] = i_edges.next_row();
+        const auto [nl, nr] = n_edges.next_row();
+        const auto [tl, tr] = t_edges.next_row();
+
+        // Same for spans long enough to cover whole tiles of the hierarchical Z.
+        if constexpr (kState.depth_tested)
+        {
+            if ((xr - xl) >= DepthBuffer::kHiZTileSize &&
+                depth_buffer->is_occluded({ xl, y }, { xr, y }, std::max(zl, zr)))
+            {
+                continue;
+            }
+        }
+
+        // Interpolate attributes for this scanline.
+        Interpolator<float> segment_zs{ xl, zl, xr, zr };
+        Interpolator<float> segment_intensities{ xl, il, xr, ir };
+        Interpolator<Vec3> segment_normals{ xl, nl, xr, nr };
+        Interpolator<TexCoords> segment_tex_coords{ xl, tl, xr, tr };
+
+        const int first_x = std::max(xl, window_min.x);
+        const int last_x = std::min(xr, window_max.x);
+
+        if (first_x > xl)
+        {
+            const int skipped_pixels = first_x - xl;
+            segment_zs.skip(skipped_pixels);
+            segment_intensities.skip(skipped_pixels);
+            segment_normals.skip(skipped_pixels);
+            segment_tex_coords.skip(skipped_pixels);
+        }
+
+        for (int x = first_x; x <= last_x; ++x)
+        {
+            const Point2 pt = { x, y };
+
+            // Step every attribute, also for pixels failing the depth test.
+            const float z_val = kState.depth_tested ? segment_zs.next() : 1.0f;
+            const float intensity_val = std::min(segment_intensities.next(), 1.0f);
+            const Vec3 normal = segment_normals.next();
+            const TexCoords tex_coords = segment_tex_coords.next();
+
+            if constexpr (kState.depth_tested)
+            {
+                if (!test_pixel_depth<kState>(*depth_buffer, pt, z_val, triangle.id))
+                {
+                    continue;
+                }
+            }
+
+            if constexpr (kState.pass == TrianglePass::kVisibility)
+            {
+                continue;
+            }
+
+            Color color = triangle.color;
+
+            if constexpr (kState.textured)
+            {
+                // Perspective correct: divide by Z.
+                color = sample_triangle_texture(triangle, tex_gradients, kState.depth_tested ? tex_coords / z_val : tex_coords, z_val);
+            }
+
+            if constexpr (kState.shading == TriangleShading::kIntensity)
+            {
+                color = color * intensity_val;
+            }
+            else if constexpr (kState.shading == TriangleShading::kPhong)
+            {
+                const Point3 vertex = canvas.unproject_vertex(pt, z_val);
+                const float lighting_val = std::min(compute_lighting_fn(vertex, normal), 1.0f);
+                color = color * lighting_val;
+            }
+
+            canvas.draw_pixel(pt, color);
+        }
+    }
+}
+
 // ==========
 // WIREFRAME:
 // ==========
@@ -118,9 +432,7 @@ auto draw_shaded_textured_triangle_depth_tested(Canvas& canvas,
 // PHONG SHADING:
 // ==============
 
-// Given a point and a normal, compute and return the light intensity for it.
-using PhongLightingFunc = std::function<float(Point3, Vec3)>;
-
+template<PhongLightingFunc LightingFunc>
 auto draw_phong_shaded_triangle(Canvas& canvas,
                                 const Point2 p0,
                                 const Vec3 n0,
@@ -129,8 +441,22 @@ auto draw_phong_shaded_triangle(Canvas& canvas,
                                 const Point2 p2,
                                 const Vec3 n2,
                                 const Color& color,
-                                PhongLightingFunc&& compute_lighting_fn) -> void;
+                                LightingFunc&& compute_lighting_fn) -> void
+{
+    const RasterTriangle triangle{
+        .verts = {{
+            { .point = p0, .normal = n0 },
+            { .point = p1, .normal = n1 },
+            { .point = p2, .normal = n2 }
+        }},
+        .color = color
+    };
+
+    constexpr TriangleState kState{ .shading = TriangleShading::kPhong };
+    draw_triangle_scanline<kState>(canvas, nullptr, triangle, compute_lighting_fn);
+}
 
+template<PhongLightingFunc LightingFunc>
 auto draw_phong_shaded_textured_triangle(Canvas& canvas,
                                          const Point2 p0,
                                          const Vec3 n0,
@@ -142,8 +468,22 @@ auto draw_phong_shaded_textured_triangle(Canvas& canvas,
                                          const Vec3 n2,
                                          const TexCoords t2,
                                          const Texture& texture,
-                                         PhongLightingFunc&& compute_lighting_fn) -> void;
+                                         LightingFunc&& compute_lighting_fn) -> void
+{
+    const RasterTriangle triangle{
+        .verts = {{
+            { .point = p0, .normal = n0, .tex_coords = t0 },
+            { .point = p1, .normal = n1, .tex_coords = t1 },
+            { .point = p2, .normal = n2, .tex_coords = t2 }
+        }},
+        .texture = &texture
+    };
+
+    constexpr TriangleState kState{ .shading = TriangleShading::kPhong, .textured = true };
+    draw_triangle_scanline<kState>(canvas, nullptr, triangle, compute_lighting_fn);
+}
 
+template<PhongLightingFunc LightingFunc>
 auto draw_phong_shaded_triangle_depth_tested(Canvas& canvas,
                                              DepthBuffer& depth_buffer,
                                              const Point2 p0,
@@ -156,8 +496,22 @@ auto draw_phong_shaded_triangle_depth_tested(Canvas& canvas,
                                              const float z2,
                                              const Vec3 n2,
                                              const Color& color,
-                                             PhongLightingFunc&& compute_lighting_fn) -> void;
+                                             LightingFunc&& compute_lighting_fn) -> void
+{
+    const RasterTriangle triangle{
+        .verts = {{
+            { .point = p0, .z = z0, .normal = n0 },
+            { .point = p1, .z = z1, .normal = n1 },
+            { .point = p2, .z = z2, .normal = n2 }
+        }},
+        .color = color
+    };
+
+    constexpr TriangleState kState{ .shading = TriangleShading::kPhong, .depth_tested = true };
+    draw_triangle_scanline<kState>(canvas, &depth_buffer, triangle, compute_lighting_fn);
+}
 
+template<PhongLightingFunc LightingFunc>
 auto draw_phong_shaded_textured_triangle_depth_tested(Canvas& canvas,
                                                       DepthBuffer& depth_buffer,
                                                       const Point2 p0,
@@ -173,6 +527,19 @@ auto draw_phong_shaded_textured_triangle_depth_tested(Canvas& canvas,
                                                       const Vec3 n2,
                                                       const TexCoords t2,
                                                       const Texture& texture,
-                                                      PhongLightingFunc&& compute_lighting_fn) -> void;
+                                                      LightingFunc&& compute_lighting_fn) -> void
+{
+    const RasterTriangle triangle{
+        .verts = {{
+            { .point = p0, .z = z0, .normal = n0, .tex_coords = t0 },
+            { .point = p1, .z = z1, .normal = n1, .tex_coords = t1 },
+            { .point = p2, .z = z2, .normal = n2, .tex_coords = t2 }
+        }},
+        .texture = &texture
+    };
+
+    constexpr TriangleState kState{ .shading = TriangleShading::kPhong, .textured = true, .depth_tested = true };
+    draw_triangle_scanline<kState>(canvas, &depth_buffer, triangle, compute_lighting_fn);
+}
 
 } // cgfs::rasterizer
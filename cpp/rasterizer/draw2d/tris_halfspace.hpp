@@ -0,0 +1,342 @@
+#pragma once
+
+#include "tris.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace cgfs::rasterizer
+{
+
+// ===========================
+// HALF-SPACE (EDGE FUNCTION):
+// ===========================
+
+// Alternative to the scanline functions in tris.hpp. Pixels are tested against the three
+// edge functions of the triangle instead of walking interpolated left/right edges:
+// the bounding box is visited in 8x8 tiles, tiles fully inside or outside the triangle are
+// accepted/rejected from their corners, and only tiles straddling an edge test each pixel.
+
+// Internals of draw_triangle_halfspace(), which is a template and so lives in the header.
+namespace halfspace
+{
+
+// ========================================================
+// Edge functions:
+// ========================================================
+
+constexpr int kTileSize = 8;
+
+// E(x, y) = a*x + b*y + c: twice the signed area of the triangle (v0, v1, (x, y)).
+// 64-bit since vertices projected close to the camera plane can be far off canvas.
+struct EdgeFunction final
+{
+    std::int64_t a{ 0 };
+    std::int64_t b{ 0 };
+    std::int64_t c{ 0 };
+
+    auto at(const int x, const int y) const -> std::int64_t
+    {
+        return (a * x) + (b * y) + c;
+    }
+};
+
+inline auto make_edge(const Point2 v0, const Point2 v1) -> EdgeFunction
+{
+    return {
+        .a = static_cast<std::int64_t>(v0.y) - v1.y,
+        .b = static_cast<std::int64_t>(v1.x) - v0.x,
+        .c = (static_cast<std::int64_t>(v0.x) * v1.y) - (static_cast<std::int64_t>(v1.x) * v0.y)
+    };
+}
+
+// True if all 4 corners of the tile are on the inner side of the edge.
+inline auto is_tile_inside(const EdgeFunction& edge, const int tile_x, const int tile_y) -> bool
+{
+    const int last = kTileSize - 1;
+    return edge.at(tile_x, tile_y) >= 0 && edge.at(tile_x + last, tile_y) >= 0 &&
+           edge.at(tile_x, tile_y + last) >= 0 && edge.at(tile_x + last, tile_y + last) >= 0;
+}
+
+// True if all 4 corners of the tile are on the outer side of the edge.
+inline auto is_tile_outside(const EdgeFunction& edge, const int tile_x, const int tile_y) -> bool
+{
+    const int last = kTileSize - 1;
+    return edge.at(tile_x, tile_y) < 0 && edge.at(tile_x + last, tile_y) < 0 &&
+           edge.at(tile_x, tile_y + last) < 0 && edge.at(tile_x + last, tile_y + last) < 0;
+}
+
+// Calls `shade_pixel(point, b0, b1, b2)` for every canvas pixel covered by the triangle,
+// where b0-b2 are the screen space barycentric weights of each vertex. Edges are inclusive,
+// like the scanline rasterizer, so triangles sharing an edge leave no gaps.
+// Tiles overlapping the triangle are skipped entirely if `skip_tile(tile_x, tile_y)` returns true.
+template<typename SkipTileFunc, typename ShadePixelFunc>
+auto rasterize_triangle(const Canvas& canvas,
+                        const Point2 p0,
+                        const Point2 p1,
+                        const Point2 p2,
+                        SkipTileFunc&& skip_tile,
+                        ShadePixelFunc&& shade_pixel) -> void
+{
+    // Each edge function is zero on its edge and reaches `area` at the opposite vertex.
+    std::array<EdgeFunction, 3> edges = { make_edge(p1, p2), make_edge(p2, p0), make_edge(p0, p1) };
+    std::int64_t area = edges[2].at(p2.x, p2.y);
+
+    if (area == 0)
+    {
+        return; // Degenerate; no interior pixels.
+    }
+
+    // Clockwise winding: flip the edges so the interior is always on the positive side.
+    if (area < 0)
+    {
+        for (EdgeFunction& edge : edges)
+        {
+            edge = { .a = -edge.a, .b = -edge.b, .c = -edge.c };
+        }
+        area = -area;
+    }
+
+    const float inv_area = 1.0f / static_cast<float>(area);
+
+    // Only the canvas window is visited, so drawing into a slice skips the parts of the triangle outside of it.
+    const Point2 window_min = canvas.window_min();
+    const Point2 window_max = canvas.window_max();
+
+    const int min_x = std::max(std::min({ p0.x, p1.x, p2.x }), window_min.x);
+    const int min_y = std::max(std::min({ p0.y, p1.y, p2.y }), window_min.y);
+    const int max_x = std::min(std::max({ p0.x, p1.x, p2.x }), window_max.x);
+    const int max_y = std::min(std::max({ p0.y, p1.y, p2.y }), window_max.y);
+
+    if (min_x > max_x || min_y > max_y)
+    {
+        return; // Fully off canvas.
+    }
+
+    // Tiles are aligned to the canvas window so neighboring triangles share the same grid.
+    const int first_tile_x = min_x - ((min_x - window_min.x) % kTileSize);
+    const int first_tile_y = min_y - ((min_y - window_min.y) % kTileSize);
+
+    for (int tile_y = first_tile_y; tile_y <= max_y; tile_y += kTileSize)
+    {
+        for (int tile_x = first_tile_x; tile_x <= max_x; tile_x += kTileSize)
+        {
+            if (is_tile_outside(edges[0], tile_x, tile_y) ||
+                is_tile_outside(edges[1], tile_x, tile_y) ||
+                is_tile_outside(edges[2], tile_x, tile_y) ||
+                skip_tile(tile_x, tile_y))
+            {
+                continue;
+            }
+
+            const bool tile_inside = is_tile_inside(edges[0], tile_x, tile_y) &&
+                              is_tile_inside(edges[1], tile_x, tile_y) &&
+                              is_tile_inside(edges[2], tile_x, tile_y);
+
+            // Tiles on the border of the bounding box are only partially visited.
+            const int lane_start = std::max(min_x - tile_x, 0);
+            const int lane_end = std::min(max_x - tile_x + 1, kTileSize);
+            const int y_start = std::max(tile_y, min_y);
+            const int y_end = std::min(tile_y + kTileSize, max_y + 1);
+
+            for (int y = y_start; y < y_end; ++y)
+            {
+                const std::int64_t row0 = edges[0].at(tile_x, y);
+                const std::int64_t row1 = edges[1].at(tile_x, y);
+                const std::int64_t row2 = edges[2].at(tile_x, y);
+
+                // Coverage of the whole row as a bit mask. The lane loop has no branches,
+                // so the three edge tests vectorize across the row.
+                std::uint32_t coverage = (1u << kTileSize) - 1;
+                if (!tile_inside)
+                {
+                    coverage = 0;
+                    for (int lane = 0; lane < kTileSize; ++lane)
+                    {
+                        const bool inside = ((row0 + (edges[0].a * lane)) >= 0) &
+                                     ((row1 + (edges[1].a * lane)) >= 0) &
+                                     ((row2 + (edges[2].a * lane)) >= 0);
+                        coverage |= static_cast<std::uint32_t>(inside) << lane;
+                    }
+                }
+
+                for (int lane = lane_start; lane < lane_end; ++lane)
+                {
+                    if ((coverage & (1u << lane)) == 0)
+                    {
+                        continue;
+                    }
+
+                    const float b0 = static_cast<float>(row0 + (edges[0].a * lane)) * inv_area;
+                    const float b1 = static_cast<float>(row1 + (edges[1].a * lane)) * inv_area;
+                    const float b2 = 1.0f - b0 - b1;
+
+                    shade_pixel(Point2{ tile_x + lane, y }, b0, b1, b2);
+                }
+            }
+        }
+    }
+}
+
+// ========================================================
+// Barycentric interpolation:
+// ========================================================
+
+// 1/z over the triangle's plane, which is linear in screen space: a*x + b*y + c.
+// In double precision since the terms can be large and cancel out for small triangles.
+struct DepthPlane final
+{
+    double a{ 0.0 };
+    double b{ 0.0 };
+    double c{ 0.0 };
+    float max_inv_z{ 0.0f }; // Largest value over the triangle itself; at one of the vertices.
+
+    DepthPlane(const Point2 p0, const Point2 p1, const Point2 p2,
+               const float inv_z0, const float inv_z1, const float inv_z2)
+        : max_inv_z{ std::max({ inv_z0, inv_z1, inv_z2 }) }
+    {
+        const EdgeFunction e0 = make_edge(p1, p2);
+        const EdgeFunction e1 = make_edge(p2, p0);
+        const EdgeFunction e2 = make_edge(p0, p1);
+
+        // Barycentric weights are the edge functions over the signed area, whichever the winding.
+        const std::int64_t area = e2.at(p2.x, p2.y);
+        if (area != 0)
+        {
+            const double inv_area = 1.0 / static_cast<double>(area);
+            a = ((e0.a * double(inv_z0)) + (e1.a * double(inv_z1)) + (e2.a * double(inv_z2))) * inv_area;
+            b = ((e0.b * double(inv_z0)) + (e1.b * double(inv_z1)) + (e2.b * double(inv_z2))) * inv_area;
+            c = ((e0.c * double(inv_z0)) + (e1.c * double(inv_z1)) + (e2.c * double(inv_z2))) * inv_area;
+        }
+    }
+
+    // Upper bound of 1/z for the part of the triangle inside the rectangle.
+    auto max_over(const int x0, const int y0, const int x1, const int y1) const -> float
+    {
+        const double plane_max = (a * (a > 0.0 ? x1 : x0)) + (b * (b > 0.0 ? y1 : y0)) + c;
+        return std::min(static_cast<float>(plane_max), max_inv_z);
+    }
+};
+
+template<typename T>
+inline auto blend(const T& a0, const T& a1, const T& a2, const float b0, const float b1, const float b2) -> T
+{
+    return (a0 * b0) + (a1 * b1) + (a2 * b2);
+}
+
+} // halfspace
+
+// Same options and interpolation rules as draw_triangle_scanline() in tris.hpp:
+// depth testing uses inverse Z and texturing is perspective correct when depth tested.
+template<TriangleState kState, PhongLightingFunc LightingFunc>
+auto draw_triangle_halfspace(Canvas& canvas,
+                             DepthBuffer* depth_buffer,
+                             const RasterTriangle& triangle,
+                             LightingFunc&& compute_lighting_fn) -> void
+{
+    using halfspace::blend;
+
+    assert(!kState.textured || triangle.texture != nullptr);
+    assert(!kState.depth_tested || depth_buffer != nullptr);
+    static_assert(kState.depth_tested || kState.pass == TrianglePass::kColor, "Deferred shading passes need depth testing.");
+
+    const auto& [v0, v1, v2] = triangle.verts;
+
+    // Inverse Z is linear in screen space, which makes it the value to interpolate.
+    const float inv_z0 = 1.0f / v0.z;
+    const float inv_z1 = 1.0f / v1.z;
+    const float inv_z2 = 1.0f / v2.z;
+
+    // Perspective correct texture mapping (divide by Z) when depth values are available.
+    const TexCoords t0 = kState.depth_tested ? v0.tex_coords * inv_z0 : v0.tex_coords;
+    const TexCoords t1 = kState.depth_tested ? v1.tex_coords * inv_z1 : v1.tex_coords;
+    const TexCoords t2 = kState.depth_tested ? v2.tex_coords * inv_z2 : v2.tex_coords;
+
+    // Only read for textures with mipmaps.
+    const TexCoordGradients tex_gradients{
+        v0.point, v1.point, v2.point,
+        t0, t1, t2,
+        kState.depth_tested ? inv_z0 : 1.0f,
+        kState.depth_tested ? inv_z1 : 1.0f,
+        kState.depth_tested ? inv_z2 : 1.0f
+    };
+
+    const halfspace::DepthPlane depth_plane{ v0.point, v1.point, v2.point, inv_z0, inv_z1, inv_z2 };
+
+    if constexpr (kState.depth_tested)
+    {
+        // Skip triangles behind what's already drawn.
+        const Point2 min_pt{ std::min({ v0.point.x, v1.point.x, v2.point.x }), std::min({ v0.point.y, v1.point.y, v2.point.y }) };
+        const Point2 max_pt{ std::max({ v0.point.x, v1.point.x, v2.point.x }), std::max({ v0.point.y, v1.point.y, v2.point.y }) };
+
+        if (depth_buffer->is_occluded(min_pt, max_pt, depth_plane.max_inv_z))
+        {
+            return;
+        }
+    }
+
+    // Then tiles, with the maximum 1/z of the triangle plane over each tile.
+    const auto skip_tile = [&](const int tile_x, const int tile_y) -> bool
+    {
+        if constexpr (kState.depth_tested)
+        {
+            const int last = halfspace::kTileSize - 1;
+            const float tile_max_inv_z = depth_plane.max_over(tile_x, tile_y, tile_x + last, tile_y + last);
+            return depth_buffer->is_occluded({ tile_x, tile_y }, { tile_x + last, tile_y + last }, tile_max_inv_z);
+        }
+        else
+        {
+            return false;
+        }
+    };
+
+    halfspace::rasterize_triangle(canvas, v0.point, v1.point, v2.point, skip_tile,
+                                  [&](const Point2 pt, const float b0, const float b1, const float b2)
+    {
+        float z_val = 1.0f;
+
+        if constexpr (kState.depth_tested)
+        {
+            z_val = blend(inv_z0, inv_z1, inv_z2, b0, b1, b2);
+            if (!test_pixel_depth<kState>(*depth_buffer, pt, z_val, triangle.id))
+            {
+                return;
+            }
+        }
+
+        if constexpr (kState.pass == TrianglePass::kVisibility)
+        {
+            return;
+        }
+
+        Color color = triangle.color;
+
+        if constexpr (kState.textured)
+        {
+            TexCoords tex_coords = blend(t0, t1, t2, b0, b1, b2);
+            if constexpr (kState.depth_tested)
+            {
+                tex_coords /= z_val;
+            }
+            color = sample_triangle_texture(triangle, tex_gradients, tex_coords, z_val);
+        }
+
+        if constexpr (kState.shading == TriangleShading::kIntensity)
+        {
+            const float intensity_val = std::min(blend(v0.intensity, v1.intensity, v2.intensity, b0, b1, b2), 1.0f);
+            color = color * intensity_val;
+        }
+        else if constexpr (kState.shading == TriangleShading::kPhong)
+        {
+            const Point3 vertex = canvas.unproject_vertex(pt, z_val);
+            const Vec3 normal = blend(v0.normal, v1.normal, v2.normal, b0, b1, b2);
+            const float intensity_val = std::min(compute_lighting_fn(vertex, normal), 1.0f);
+            color = color * intensity_val;
+        }
+
+        canvas.draw_pixel(pt, color);
+    });
+}
+
+} // cgfs::rasterizer
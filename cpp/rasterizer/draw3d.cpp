@@ -1,6 +1,14 @@
 #include "draw3d.hpp"
 #include "draw2d/lines.hpp"
 #include "draw2d/tris.hpp"
+#include "draw2d/tris_halfspace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <span>
+#include <utility>
+#include <vector>
 
 namespace cgfs::rasterizer
 {
@@ -9,51 +17,80 @@ namespace cgfs::rasterizer
 // Lighting & shading:
 // ========================================================
 
-// Returns the computed light intensity for the vertex.
-static auto compute_lighting(const LightModel::Type light_model,
-                             const Point3& vertex,
-                             const Vec3& normal,
-                             const Camera& camera,
-                             const float specular,
-                             const std::span<const Light> lights) -> float
+// Directional or point light in camera space.
+struct PreparedLight final
 {
-    if (light_model & LightModel::kDisabled)
-    {
-        return 1.0f;
-    }
-    
-    float intensity = 0.0f;
+    Light::Type type{};
+    Vec3 vector{}; // Direction of directional lights, position of point lights.
+    float intensity{ 0.0f };
+};
+
+// Scene lights prepared once per draw, so lighting a sample is only the diffuse and specular math.
+struct PreparedLights final
+{
+    float ambient{ 0.0f }; // Sum of all ambient lights.
+    std::vector<PreparedLight> lights{};
+    Point3 view_origin{};
+};
+
+static auto prepare_lights(const Camera& camera, const std::span<const Light> lights) -> PreparedLights
+{
+    const Mat3 camera_rotation = Mat3::transposed(camera.rotation);
+    const Mat4 camera_matrix = camera.to_mat4();
+
+    PreparedLights prepared{ .view_origin = camera.position };
 
     for (const Light& light : lights)
     {
         if (light.type == Light::Type::kAmbient)
         {
-            intensity += light.intensity;
-            continue;
+            prepared.ambient += light.intensity;
         }
-
-        Vec3 light_vector{};
-        if (light.type == Light::Type::kDirectional)
+        else if (light.type == Light::Type::kDirectional)
         {
-            const Mat3 camera_matrix = Mat3::transposed(camera.rotation);
-            const Vec3 rotated_light = camera_matrix * light.position;
-            light_vector = rotated_light; // Position is a vector already for directional lights.
+            // Position is a vector already for directional lights.
+            prepared.lights.push_back({ .type = light.type, .vector = camera_rotation * light.position, .intensity = light.intensity });
         }
         else if (light.type == Light::Type::kPoint)
         {
-            const Mat4 camera_matrix = camera.to_mat4();
             const Vec4 transformed_light = camera_matrix * Vec4{ light.position, 1.0f };
-            light_vector = (vertex * -1.0f) + transformed_light.xyz();
+            prepared.lights.push_back({ .type = light.type, .vector = transformed_light.xyz(), .intensity = light.intensity });
         }
         else
         {
             assert(false);
         }
+    }
+
+    return prepared;
+}
+
+// Returns the computed light intensity for the vertex.
+static auto compute_lighting(const LightModel::Type light_model,
+                             const Point3& vertex,
+                             const Vec3& normal,
+                             const float specular,
+                             const PreparedLights& lights) -> float
+{
+    if (light_model & LightModel::kDisabled)
+    {
+        return 1.0f;
+    }
+
+    float intensity = lights.ambient;
+
+    const float normal_length = length(normal);
+    const Vec3 view = lights.view_origin - vertex;
+    const float view_length = length(view);
+
+    for (const PreparedLight& light : lights.lights)
+    {
+        const Vec3 light_vector = (light.type == Light::Type::kPoint) ? (vertex * -1.0f) + light.vector : light.vector;
 
         // Diffuse component.
         if (light_model & LightModel::kDiffuse)
         {
-            const float cos_alpha = dot(light_vector, normal) / (length(light_vector) * length(normal));
+            const float cos_alpha = dot(light_vector, normal) / (length(light_vector) * normal_length);
             if (cos_alpha > 0.0f)
             {
                 intensity += cos_alpha * light.intensity;
@@ -64,9 +101,8 @@ static auto compute_lighting(const LightModel::Type light_model,
         if (light_model & LightModel::kSpecular)
         {
             const Vec3 reflected = (normal * (2.0f * dot(normal, light_vector))) - light_vector;
-            const Vec3 view = camera.position - vertex;
 
-            const float cos_beta = dot(reflected, view) / (length(reflected) * length(view));
+            const float cos_beta = dot(reflected, view) / (length(reflected) * view_length);
             if (cos_beta > 0.0f)
             {
                 intensity += std::pow(cos_beta, specular) * light.intensity;
@@ -101,11 +137,17 @@ static auto clip_mesh_bounds(const ClippingPlanes& clipping_planes,
     return false;
 }
 
-// Check if any vertex of the triangle is outside the clipping planes.
+// Returned by find_crossed_planes() for triangles fully outside of a clipping plane.
+constexpr unsigned int kTriangleClippedOut = ~0u;
+
+// Bit mask of the clipping planes (1 << ClippingPlanes::PlaneIdx) with the triangle on both sides,
+// or kTriangleClippedOut if all of its vertices are outside of any of them.
 // Vertices already transformed by the camera and model matrix (model-view).
-static auto clip_triangle(const ClippingPlanes& clipping_planes,
-                          const Vec4& v0, const Vec4& v1, const Vec4& v2) -> bool
+static auto find_crossed_planes(const ClippingPlanes& clipping_planes,
+                                const Vec4& v0, const Vec4& v1, const Vec4& v2) -> unsigned int
 {
+    unsigned int crossed_planes = 0;
+
     for (auto p = 0; p < ClippingPlanes::kCount; ++p)
     {
         const Plane& plane = clipping_planes.planes[p];
@@ -115,21 +157,17 @@ static auto clip_triangle(const ClippingPlanes& clipping_planes,
         const int in2 = signed_distance(plane, v2.xyz()) > 0.0f;
 
         const int count = in0 + in1 + in2;
-        switch (count)
+        if (count == 0)
         {
-        case 0:
-            return true; // Triangle is fully clipped out.
-        case 1:
-            return true; // The triangle has one vertex in and two out.
-        case 2:
-            return true; // The triangle has two vertices in and one out.
-        default:
-            // The triangle is fully in front of the plane.
-            break;
+            return kTriangleClippedOut; // Triangle is fully clipped out.
+        }
+        if (count < 3)
+        {
+            crossed_planes |= 1u << p; // One or two vertices in; needs to be split.
         }
     }
-    
-    return false;
+
+    return crossed_planes;
 }
 
 static auto compute_triangle_normal(const Vec4& v0, const Vec4& v1, const Vec4& v2) -> Vec3
@@ -153,345 +191,881 @@ static auto is_back_facing_triangle(Vec3* triangle_normal_out, const Vec4& v0, c
 }
 
 // ========================================================
-// Mesh 3D drawing:
+// Geometry stage:
 // ========================================================
 
-auto draw_mesh(Canvas& canvas, DepthBuffer& depth_buffer, const DrawMeshParams& params) -> void
+// Vertex of a prepared face. Clipping creates new ones along the edges of the face.
+struct PreparedVertex final
 {
-    const Mesh& mesh = params.mesh;
-    const Camera& camera = params.camera;
+    Vec4 transformed{}; // Model-view space.
+    Point2 projected{};
+    float intensity{ 0.0f };
+    Vec3 normal{};
+    TexCoords tex_coords{};
+};
 
-    const Mat4 model_view_mtx = params.model_view_mtx;
-    const Mat3 normal_mtx = Mat3::transposed(camera.rotation) * params.rotation;
-    
-    const DrawFlags::Type draw_flags = params.draw_flags;
-    const LightModel::Type light_model = params.light_model;
-    const ShadeModel shade_model = params.shade_model;
+// Material of a mesh face, whatever its index width.
+struct FaceMaterial final
+{
+    Color color{};
+    float specular{ 0.0f };
+    const Texture* texture{ &Texture::kNone };
+};
 
-    // Transform the bounding sphere and attempt early discard.
-    if ((draw_flags & DrawFlags::kClipping) &&
-        clip_mesh_bounds(camera.clipping_planes, mesh, model_view_mtx, params.scaling))
-    {
-        return;
-    }
+// A face that passed clipping and culling, with the per-vertex values needed to draw it.
+// Clipping turns the triangle into a convex polygon, drawn as a fan of triangles.
+struct PreparedFace final
+{
+    // Each clipping plane can add one vertex to a convex polygon.
+    static constexpr int kMaxVerts = 3 + ClippingPlanes::kCount;
+
+    FaceMaterial material{};
+    const DrawMeshParams* params{ nullptr }; // Draw call the face belongs to.
+    const PreparedLights* lights{ nullptr };
+    std::array<PreparedVertex, kMaxVerts> verts{};
+    int vert_count{ 0 };
+};
+
+// Side planes only clip faces reaching outside of the guard band: a region kGuardBandScale times the
+// size of the canvas around it. Closer faces are left to the rasterizers, which only visit the pixels
+// inside the canvas, so most faces crossing the edges of the screen skip the clipping work.
+// The band keeps projected coordinates far from overflowing when converted to integers.
+constexpr float kGuardBandScale = 4.0f;
+
+// True for vertices in front of the camera that project inside the guard band.
+static auto is_inside_guard_band(const Vec4& v) -> bool
+{
+    // Canvas::project_vertex() maps x/z and y/z in [-0.5, 0.5] to the canvas with its default viewport.
+    const float limit = 0.5f * kGuardBandScale * v.z;
+    return v.z > 0.0f && std::abs(v.x) <= limit && std::abs(v.y) <= limit;
+}
+
+// Vertex at `t` along the edge from `a` to `b`.
+static auto lerp_vertex(const PreparedVertex& a, const PreparedVertex& b, const float t) -> PreparedVertex
+{
+    return {
+        .transformed = a.transformed + ((b.transformed - a.transformed) * t),
+        .intensity = a.intensity + ((b.intensity - a.intensity) * t),
+        .normal = a.normal + ((b.normal - a.normal) * t),
+        .tex_coords = a.tex_coords + ((b.tex_coords - a.tex_coords) * t)
+    };
+}
+
+// Sutherland-Hodgman: keeps the part of the face polygon in front of the plane.
+// Vertices are "in" with the same rule as find_crossed_planes().
+static auto clip_face_polygon(const Plane& plane, PreparedFace& prepared) -> void
+{
+    std::array<PreparedVertex, PreparedFace::kMaxVerts> clipped{};
+    int clipped_count = 0;
 
-    for (const Mesh::Face& face : mesh.faces)
+    for (int v = 0; v < prepared.vert_count; ++v)
     {
-        const Point3& vert0 = mesh.vertices[face.verts[0]];
-        const Point3& vert1 = mesh.vertices[face.verts[1]];
-        const Point3& vert2 = mesh.vertices[face.verts[2]];
+        const PreparedVertex& a = prepared.verts[v];
+        const PreparedVertex& b = prepared.verts[(v + 1) % prepared.vert_count];
 
-        const Vec4 transformed_vert0 = model_view_mtx * Vec4{ vert0, 1.0f };
-        const Vec4 transformed_vert1 = model_view_mtx * Vec4{ vert1, 1.0f };
-        const Vec4 transformed_vert2 = model_view_mtx * Vec4{ vert2, 1.0f };
+        const float distance_a = signed_distance(plane, a.transformed.xyz());
+        const float distance_b = signed_distance(plane, b.transformed.xyz());
 
-        if ((draw_flags & DrawFlags::kClipping) &&
-            clip_triangle(camera.clipping_planes, transformed_vert0, transformed_vert1, transformed_vert2))
+        if (distance_a > 0.0f)
         {
-            // NOTE: Instead of discarding the triangle here we should instead
-            // check how many vertices are inside the clipping planes and how
-            // many are out. If all 3 are out then we discard, otherwise we should
-            // split the triangle by the clip plane it intersects. That would result
-            // in either one or two new triangles that we would render instead.
-            continue;
+            clipped[clipped_count++] = a;
         }
 
-        Vec3 triangle_normal{};
-        if ((draw_flags & DrawFlags::kBackFaceCull) &&
-            is_back_facing_triangle(&triangle_normal, transformed_vert0, transformed_vert1, transformed_vert2))
+        // The edge crosses the plane; add the intersection.
+        if ((distance_a > 0.0f) != (distance_b > 0.0f))
         {
-            continue;
+            clipped[clipped_count++] = lerp_vertex(a, b, distance_a / (distance_a - distance_b));
         }
+    }
+
+    assert(clipped_count <= PreparedFace::kMaxVerts);
+    prepared.verts = clipped;
+    prepared.vert_count = clipped_count;
+}
+
+// Splits the face by the planes it crosses. The near plane always clips, as points behind the
+// camera can't be projected; the others only if the face leaves the guard band.
+static auto clip_face(const ClippingPlanes& clipping_planes, const unsigned int crossed_planes, PreparedFace& prepared) -> void
+{
+    constexpr unsigned int kNearBit = 1u << ClippingPlanes::kNear;
 
-        const Point2 projected_vert0 = canvas.project_vertex(transformed_vert0.xyz());
-        const Point2 projected_vert1 = canvas.project_vertex(transformed_vert1.xyz());
-        const Point2 projected_vert2 = canvas.project_vertex(transformed_vert2.xyz());
+    if (crossed_planes & kNearBit)
+    {
+        clip_face_polygon(clipping_planes.planes[ClippingPlanes::kNear], prepared);
+    }
 
-        // Light & shading:
-        float intensities[3] = {};
-        Vec3 normals[3] = {};
+    const unsigned int side_planes = crossed_planes & ~kNearBit;
+    if (side_planes == 0)
+    {
+        return;
+    }
 
-        // Flat shading: compute lighting for the entire triangle.
-        if (shade_model == ShadeModel::kFlat)
+    const auto first_vert = prepared.verts.begin();
+    const auto last_vert = first_vert + prepared.vert_count;
+    if (std::all_of(first_vert, last_vert, [](const PreparedVertex& v) { return is_inside_guard_band(v.transformed); }))
+    {
+        return;
+    }
+
+    for (auto p = 0; p < static_cast<int>(ClippingPlanes::kCount) && prepared.vert_count >= 3; ++p)
+    {
+        if (side_planes & (1u << p))
         {
-            if (draw_flags & DrawFlags::kComputeFaceNormals)
+            clip_face_polygon(clipping_planes.planes[p], prepared);
+        }
+    }
+}
+
+// Mesh vertices and normals of one draw call, transformed once and shared by all of its
+// faces, instead of once per face corner.
+struct TransformedMesh final
+{
+    std::vector<Vec4> positions{};   // Model-view space.
+    std::vector<Point2> projected{}; // Canvas position of the vertices inside the guard band.
+    std::vector<Vec3> normals{};     // Camera space. Empty if the draw call doesn't read mesh normals.
+};
+
+// Points transformed per batch by transform_positions() and transform_normals().
+// The lane loops have no branches, so the compiler maps them to SIMD registers.
+constexpr std::size_t kTransformLanes = 8;
+
+// out[i] = mtx * (points[i], 1). Same operation order as the Mat4 vector product, so the results are identical.
+static auto transform_positions(const Mat4& mtx, std::span<const Point3> points, std::span<Vec4> out) -> void
+{
+    assert(points.size() == out.size());
+
+    for (std::size_t base = 0; base < points.size(); base += kTransformLanes)
+    {
+        const std::size_t lane_count = std::min(kTransformLanes, points.size() - base);
+
+        std::array<float, kTransformLanes> x{};
+        std::array<float, kTransformLanes> y{};
+        std::array<float, kTransformLanes> z{};
+
+        for (std::size_t i = 0; i < lane_count; ++i)
+        {
+            x[i] = points[base + i].x;
+            y[i] = points[base + i].y;
+            z[i] = points[base + i].z;
+        }
+
+        for (std::size_t row = 0; row < 4; ++row)
+        {
+            std::array<float, kTransformLanes> lane_results;
+            for (std::size_t i = 0; i < kTransformLanes; ++i)
             {
-                normals[0] = triangle_normal;
+                lane_results[i] = (x[i] * mtx.m[row][0]) + (y[i] * mtx.m[row][1]) + (z[i] * mtx.m[row][2]) + mtx.m[row][3];
             }
-            else
+
+            for (std::size_t i = 0; i < lane_count; ++i)
             {
-                normals[0] = normal_mtx * mesh.normals[face.normals[0]];
+                out[base + i][row] = lane_results[i];
             }
+        }
+    }
+}
+
+// out[i] = mtx * vectors[i]. Same operation order as the Mat3 vector product.
+static auto transform_normals(const Mat3& mtx, std::span<const Vec3> vectors, std::span<Vec3> out) -> void
+{
+    assert(vectors.size() == out.size());
 
-            const Vec4 center = (transformed_vert0 + transformed_vert1 + transformed_vert2) / 3.0f;
-            intensities[0] = compute_lighting(light_model, center.xyz(), normals[0], camera, face.specular, params.lights);
-            intensities[1] = intensities[0];
-            intensities[2] = intensities[0];
+    for (std::size_t base = 0; base < vectors.size(); base += kTransformLanes)
+    {
+        const std::size_t lane_count = std::min(kTransformLanes, vectors.size() - base);
+
+        std::array<float, kTransformLanes> x{};
+        std::array<float, kTransformLanes> y{};
+        std::array<float, kTransformLanes> z{};
+
+        for (std::size_t i = 0; i < lane_count; ++i)
+        {
+            x[i] = vectors[base + i].x;
+            y[i] = vectors[base + i].y;
+            z[i] = vectors[base + i].z;
         }
-        // Gouraud shading: compute lighting at the vertices.
-        else if (shade_model == ShadeModel::kGouraud)
+
+        for (std::size_t row = 0; row < 3; ++row)
         {
-            if (draw_flags & DrawFlags::kComputeFaceNormals)
+            std::array<float, kTransformLanes> lane_results;
+            for (std::size_t i = 0; i < kTransformLanes; ++i)
             {
-                normals[0] = triangle_normal;
-                normals[1] = triangle_normal;
-                normals[2] = triangle_normal;
+                lane_results[i] = (x[i] * mtx.m[row][0]) + (y[i] * mtx.m[row][1]) + (z[i] * mtx.m[row][2]);
             }
-            else
+
+            for (std::size_t i = 0; i < lane_count; ++i)
             {
-                normals[0] = normal_mtx * mesh.normals[face.normals[0]];
-                normals[1] = normal_mtx * mesh.normals[face.normals[1]];
-                normals[2] = normal_mtx * mesh.normals[face.normals[2]];
+                out[base + i][row] = lane_results[i];
             }
+        }
+    }
+}
 
-            intensities[0] = compute_lighting(light_model, transformed_vert0.xyz(), normals[0], camera, face.specular, params.lights);
-            intensities[1] = compute_lighting(light_model, transformed_vert1.xyz(), normals[1], camera, face.specular, params.lights);
-            intensities[2] = compute_lighting(light_model, transformed_vert2.xyz(), normals[2], camera, face.specular, params.lights);
+// Vertex stage of a draw call: transforms and projects every mesh vertex once.
+static auto transform_mesh(const Canvas& canvas, const DrawMeshParams& params, TransformedMesh& transformed) -> void
+{
+    const Mesh& mesh = params.mesh;
+
+    transformed.positions.resize(mesh.vertices.size());
+    transform_positions(params.model_view_mtx, mesh.vertices, transformed.positions);
+
+    // Vertices outside of the guard band could overflow; faces using them are clipped or project them on their own.
+    transformed.projected.resize(mesh.vertices.size());
+    for (std::size_t v = 0; v < mesh.vertices.size(); ++v)
+    {
+        const Vec4& position = transformed.positions[v];
+        transformed.projected[v] = is_inside_guard_band(position) ? canvas.project_vertex(position.xyz()) : Point2{};
+    }
+
+    if (params.shade_model != ShadeModel::kDisabled && !(params.draw_flags & DrawFlags::kComputeFaceNormals))
+    {
+        const Mat3 normal_mtx = Mat3::transposed(params.camera.rotation) * params.rotation;
+        transformed.normals.resize(mesh.normals.size());
+        transform_normals(normal_mtx, mesh.normals, transformed.normals);
+    }
+}
+
+// Gouraud lighting of recently lit face corners, looked up by vertex index like a GPU
+// post-transform cache: faces next to each other in a mesh share most of their vertices.
+// Entries only match the same vertex, normal and specular exponent. One per draw call and thread.
+class VertexLightingCache final
+{
+public:
+
+    // Cached intensity, or the result of `compute_fn()` on a miss.
+    template<typename ComputeFunc>
+    auto get(const std::uint32_t vertex, const std::uint32_t normal, const float specular, ComputeFunc&& compute_fn) -> float
+    {
+        Entry& entry = m_entries[vertex % kSize];
+        if (entry.vertex != vertex || entry.normal != normal || entry.specular != specular)
+        {
+            entry = { .vertex = vertex, .normal = normal, .specular = specular, .intensity = compute_fn() };
+        }
+        return entry.intensity;
+    }
+
+private:
+
+    static constexpr std::size_t kSize = 64;
+
+    struct Entry final
+    {
+        std::uint32_t vertex{ ~0u };
+        std::uint32_t normal{ 0 };
+        float specular{ 0.0f };
+        float intensity{ 0.0f };
+    };
+
+    std::array<Entry, kSize> m_entries{};
+};
+
+// Geometry stage: clips, culls and lights one face of a transformed mesh.
+// Returns false if the face is not visible.
+template<typename FaceT>
+static auto prepare_face(const Canvas& canvas,
+                         const DrawMeshParams& params,
+                         const PreparedLights& lights,
+                         const TransformedMesh& transformed,
+                         const FaceT& face,
+                         VertexLightingCache& lighting_cache,
+                         PreparedFace& prepared) -> bool
+{
+    const Mesh& mesh = params.mesh;
+    const Camera& camera = params.camera;
+
+    const DrawFlags::Type draw_flags = params.draw_flags;
+    const LightModel::Type light_model = params.light_model;
+    const ShadeModel shade_model = params.shade_model;
+
+    const Vec4& transformed_vert0 = transformed.positions[face.verts[0]];
+    const Vec4& transformed_vert1 = transformed.positions[face.verts[1]];
+    const Vec4& transformed_vert2 = transformed.positions[face.verts[2]];
+
+    unsigned int crossed_planes = 0;
+    if (draw_flags & DrawFlags::kClipping)
+    {
+        crossed_planes = find_crossed_planes(camera.clipping_planes, transformed_vert0, transformed_vert1, transformed_vert2);
+        if (crossed_planes == kTriangleClippedOut)
+        {
+            return false;
+        }
+    }
+
+    Vec3 triangle_normal{};
+    if ((draw_flags & DrawFlags::kBackFaceCull) &&
+        is_back_facing_triangle(&triangle_normal, transformed_vert0, transformed_vert1, transformed_vert2))
+    {
+        return false;
+    }
+
+    // Light & shading:
+    float intensities[3] = {};
+    Vec3 normals[3] = {};
+
+    // Flat shading: compute lighting for the entire triangle.
+    if (shade_model == ShadeModel::kFlat)
+    {
+        if (draw_flags & DrawFlags::kComputeFaceNormals)
+        {
+            normals[0] = triangle_normal;
+        }
+        else
+        {
+            normals[0] = transformed.normals[face.normals[0]];
+        }
+
+        const Vec4 center = (transformed_vert0 + transformed_vert1 + transformed_vert2) / 3.0f;
+        intensities[0] = compute_lighting(light_model, center.xyz(), normals[0], face.specular, lights);
+        intensities[1] = intensities[0];
+        intensities[2] = intensities[0];
+    }
+    // Gouraud shading: compute lighting at the vertices.
+    else if (shade_model == ShadeModel::kGouraud)
+    {
+        if (draw_flags & DrawFlags::kComputeFaceNormals)
+        {
+            normals[0] = triangle_normal;
+            normals[1] = triangle_normal;
+            normals[2] = triangle_normal;
         }
-        // Phong shading: interpolate normal vectors and compute lighting per pixel.
-        else if (shade_model == ShadeModel::kPhong)
+        else
         {
+            normals[0] = transformed.normals[face.normals[0]];
+            normals[1] = transformed.normals[face.normals[1]];
+            normals[2] = transformed.normals[face.normals[2]];
+        }
+
+        const Vec4* const transformed_verts[3] = { &transformed_vert0, &transformed_vert1, &transformed_vert2 };
+
+        for (int v = 0; v < 3; ++v)
+        {
+            const auto compute_fn = [&]() -> float
+            {
+                return compute_lighting(light_model, transformed_verts[v]->xyz(), normals[v], face.specular, lights);
+            };
+
+            // Computed face normals differ per face, so only mesh normals can be cached.
             if (draw_flags & DrawFlags::kComputeFaceNormals)
             {
-                normals[0] = triangle_normal;
-                normals[1] = triangle_normal;
-                normals[2] = triangle_normal;
+                intensities[v] = compute_fn();
             }
             else
             {
-                normals[0] = normal_mtx * mesh.normals[face.normals[0]];
-                normals[1] = normal_mtx * mesh.normals[face.normals[1]];
-                normals[2] = normal_mtx * mesh.normals[face.normals[2]];
+                intensities[v] = lighting_cache.get(face.verts[v], face.normals[v], face.specular, compute_fn);
             }
         }
+    }
+    // Phong shading: interpolate normal vectors and compute lighting per pixel.
+    else if (shade_model == ShadeModel::kPhong)
+    {
+        if (draw_flags & DrawFlags::kComputeFaceNormals)
+        {
+            normals[0] = triangle_normal;
+            normals[1] = triangle_normal;
+            normals[2] = triangle_normal;
+        }
+        else
+        {
+            normals[0] = transformed.normals[face.normals[0]];
+            normals[1] = transformed.normals[face.normals[1]];
+            normals[2] = transformed.normals[face.normals[2]];
+        }
+    }
+
+    // Texture coordinates are only read for textured faces; untextured meshes may have none.
+    const bool has_tex_coords = (draw_flags & DrawFlags::kTextureMapped) && (face.texture != &Texture::kNone);
+    const Vec4 transformed_verts[3] = { transformed_vert0, transformed_vert1, transformed_vert2 };
+
+    prepared.material = { .color = face.color, .specular = face.specular, .texture = face.texture };
+    prepared.params = &params;
+    prepared.lights = &lights;
+    prepared.vert_count = 3;
+
+    for (int v = 0; v < 3; ++v)
+    {
+        prepared.verts[v] = {
+            .transformed = transformed_verts[v],
+            .intensity = intensities[v],
+            .normal = normals[v],
+            .tex_coords = has_tex_coords ? mesh.tex_coords[face.tex_coords[v]] : TexCoords{}
+        };
+    }
+
+    // Lighting above uses the original vertices; clipped ones interpolate their results.
+    if (crossed_planes != 0)
+    {
+        clip_face(camera.clipping_planes, crossed_planes, prepared);
+        if (prepared.vert_count < 3)
+        {
+            return false;
+        }
+    }
+
+    // Unclipped faces use the projections of the vertex stage.
+    for (int v = 0; v < prepared.vert_count; ++v)
+    {
+        const Vec4& position = prepared.verts[v].transformed;
+        if (crossed_planes == 0 && is_inside_guard_band(position))
+        {
+            prepared.verts[v].projected = transformed.projected[face.verts[v]];
+        }
+        else
+        {
+            prepared.verts[v].projected = canvas.project_vertex(position.xyz());
+        }
+    }
+
+    return true;
+}
+
+// ========================================================
+// Raster stage:
+// ========================================================
 
-        const bool texture_mapped = (draw_flags & DrawFlags::kTextureMapped) && (face.texture != &Texture::kNone);
-        const bool color_filled = (draw_flags & DrawFlags::kColorFilled) || (face.texture == &Texture::kNone);
-        const bool wireframe = (draw_flags & DrawFlags::kWireframe) && !color_filled && !texture_mapped;
+enum class FaceFill : int
+{
+    kNone,
+    kWireframe,
+    kColor,
+    kTexture
+};
+
+// Raster options fixed for a whole draw call. Used as a template argument of draw_face(),
+// so each combination is drawn by its own function with no flag checks left in it.
+struct PipelineState final
+{
+    FaceFill fill{ FaceFill::kNone };
+    TriangleShading shading{ TriangleShading::kNone };
+    bool depth_tested{ false };
+    bool half_space{ false };
+    bool outlines{ false };
+    bool deferred{ false }; // Shading pass of deferred shading: only the pixels where the face ID was recorded.
+};
+
+// Per-pixel lighting of a prepared face for TriangleShading::kPhong.
+struct FaceLighting final
+{
+    const PreparedFace& prepared;
+
+    auto operator()(const Point3 point, const Vec3 normal) const -> float
+    {
+        return compute_lighting(prepared.params->light_model, point, normal, prepared.material.specular, *prepared.lights);
+    }
+};
+
+// Triangle `index` of the fan covering the face polygon: vertices 0, index + 1 and index + 2.
+static auto make_fan_triangle(const PreparedFace& prepared, const int index, RasterTriangle& triangle) -> void
+{
+    const int fan_verts[3] = { 0, index + 1, index + 2 };
+
+    for (int v = 0; v < 3; ++v)
+    {
+        const PreparedVertex& vert = prepared.verts[fan_verts[v]];
+        triangle.verts[v] = {
+            .point = vert.projected,
+            .z = vert.transformed.z,
+            .intensity = vert.intensity,
+            .normal = vert.normal,
+            .tex_coords = vert.tex_coords
+        };
+    }
+}
 
-        if (color_filled)
+// Lines along the edges of the face polygon.
+static auto draw_face_edges(Canvas& canvas, const PreparedFace& prepared, const Color& color) -> void
+{
+    for (int v = 0; v < prepared.vert_count; ++v)
+    {
+        draw_line(canvas, prepared.verts[v].projected, prepared.verts[(v + 1) % prepared.vert_count].projected, color);
+    }
+}
+
+// Fills, textures and outlines a prepared face.
+template<PipelineState kState>
+static auto draw_face(Canvas& canvas, DepthBuffer& depth_buffer, const PreparedFace& prepared, const std::uint32_t face_id) -> void
+{
+    const FaceMaterial& material = prepared.material;
+
+    if constexpr (kState.fill == FaceFill::kColor || kState.fill == FaceFill::kTexture)
+    {
+        constexpr TriangleState kTriangleState{
+            .shading = kState.shading,
+            .textured = (kState.fill == FaceFill::kTexture),
+            .depth_tested = kState.depth_tested || kState.deferred, // Deferred implies it; see select_pipelines().
+            .pass = kState.deferred ? TrianglePass::kShadeVisible : TrianglePass::kColor
+        };
+
+        RasterTriangle triangle{
+            .color = material.color,
+            .texture = kTriangleState.textured ? material.texture : nullptr,
+            .id = face_id
+        };
+
+        DepthBuffer* const depth = kTriangleState.depth_tested ? &depth_buffer : nullptr;
+
+        for (int t = 0; t < prepared.vert_count - 2; ++t)
         {
-            if (shade_model == ShadeModel::kDisabled)
+            make_fan_triangle(prepared, t, triangle);
+
+            if constexpr (kState.half_space)
             {
-                if (draw_flags & DrawFlags::kDepthTest)
-                {
-                    draw_filled_triangle_depth_tested(canvas,
-                                                      depth_buffer,
-                                                      projected_vert0,
-                                                      transformed_vert0.z,
-                                                      projected_vert1,
-                                                      transformed_vert1.z,
-                                                      projected_vert2,
-                                                      transformed_vert2.z,
-                                                      face.color);
-                }
-                else
-                {
-                    draw_filled_triangle(canvas,
-                                         projected_vert0,
-                                         projected_vert1,
-                                         projected_vert2,
-                                         face.color);
-                }
+                draw_triangle_halfspace<kTriangleState>(canvas, depth, triangle, FaceLighting{ prepared });
             }
-            else if (shade_model == ShadeModel::kFlat || shade_model == ShadeModel::kGouraud)
+            else
             {
-                if (draw_flags & DrawFlags::kDepthTest)
-                {
-                    draw_shaded_triangle_depth_tested(canvas,
-                                                      depth_buffer,
-                                                      projected_vert0,
-                                                      transformed_vert0.z,
-                                                      intensities[0],
-                                                      projected_vert1,
-                                                      transformed_vert1.z,
-                                                      intensities[1],
-                                                      projected_vert2,
-                                                      transformed_vert2.z,
-                                                      intensities[2],
-                                                      face.color);
-                }
-                else
-                {
-                    draw_shaded_triangle(canvas,
-                                         projected_vert0,
-                                         intensities[0],
-                                         projected_vert1,
-                                         intensities[1],
-                                         projected_vert2,
-                                         intensities[2],
-                                         face.color);
-                }
+                draw_triangle_scanline<kTriangleState>(canvas, depth, triangle, FaceLighting{ prepared });
             }
-            else if (shade_model == ShadeModel::kPhong)
-            {
-                auto compute_lighting_fn = [&](const Point3 point, const Vec3 normal) -> float
-                {
-                    return compute_lighting(light_model, point, normal, camera, face.specular, params.lights);
-                };
+        }
+    }
+    else if constexpr (kState.fill == FaceFill::kWireframe)
+    {
+        draw_face_edges(canvas, prepared, material.color);
+    }
 
-                if (draw_flags & DrawFlags::kDepthTest)
-                {
-                    draw_phong_shaded_triangle_depth_tested(canvas,
-                                                            depth_buffer,
-                                                            projected_vert0,
-                                                            transformed_vert0.z,
-                                                            normals[0],
-                                                            projected_vert1,
-                                                            transformed_vert1.z,
-                                                            normals[1],
-                                                            projected_vert2,
-                                                            transformed_vert2.z,
-                                                            normals[2],
-                                                            face.color,
-                                                            compute_lighting_fn);
-                }
-                else
-                {
-                    draw_phong_shaded_triangle(canvas,
-                                               projected_vert0,
-                                               normals[0],
-                                               projected_vert1,
-                                               normals[1],
-                                               projected_vert2,
-                                               normals[2],
-                                               face.color,
-                                               compute_lighting_fn);
-                }
-            }
+    if constexpr (kState.outlines)
+    {
+        draw_face_edges(canvas, prepared, material.color * 0.75f);
+    }
+}
+
+// Visibility pass of deferred shading: depth and face ID only.
+template<bool kHalfSpace>
+static auto draw_face_visibility(Canvas& canvas, DepthBuffer& depth_buffer, const PreparedFace& prepared, const std::uint32_t face_id) -> void
+{
+    constexpr TriangleState kTriangleState{ .depth_tested = true, .pass = TrianglePass::kVisibility };
+
+    RasterTriangle triangle{ .id = face_id };
+
+    for (int t = 0; t < prepared.vert_count - 2; ++t)
+    {
+        make_fan_triangle(prepared, t, triangle);
+
+        if constexpr (kHalfSpace)
+        {
+            draw_triangle_halfspace<kTriangleState>(canvas, &depth_buffer, triangle, NoLighting{});
         }
-        else if (texture_mapped)
+        else
         {
-            const TexCoords tex_coords0 = mesh.tex_coords[face.tex_coords[0]];
-            const TexCoords tex_coords1 = mesh.tex_coords[face.tex_coords[1]];
-            const TexCoords tex_coords2 = mesh.tex_coords[face.tex_coords[2]];
+            draw_triangle_scanline<kTriangleState>(canvas, &depth_buffer, triangle, NoLighting{});
+        }
+    }
+}
 
-            if (shade_model == ShadeModel::kDisabled)
-            {
-                if (draw_flags & DrawFlags::kDepthTest)
-                {
-                    draw_textured_triangle_depth_tested(canvas,
-                                                        depth_buffer,
-                                                        projected_vert0,
-                                                        transformed_vert0.z,
-                                                        tex_coords0,
-                                                        projected_vert1,
-                                                        transformed_vert1.z,
-                                                        tex_coords1,
-                                                        projected_vert2,
-                                                        transformed_vert2.z,
-                                                        tex_coords2,
-                                                        *face.texture);
-                }
-                else
-                {
-                    draw_textured_triangle(canvas,
-                                           projected_vert0,
-                                           tex_coords0,
-                                           projected_vert1,
-                                           tex_coords1,
-                                           projected_vert2,
-                                           tex_coords2,
-                                           *face.texture);
-                }
-            }
-            else if (shade_model == ShadeModel::kFlat || shade_model == ShadeModel::kGouraud)
+using DrawFaceFunc = void (*)(Canvas&, DepthBuffer&, const PreparedFace&, std::uint32_t);
+
+// Every PipelineState maps to an index into a table of draw_face() instances.
+// A new state field only needs its number of values added here.
+constexpr int kFillCount = 4;
+constexpr int kShadingCount = 3;
+constexpr std::size_t kPipelineStateCount = kFillCount * kShadingCount * 2 * 2 * 2 * 2;
+
+static constexpr auto pipeline_state_from_index(std::size_t index) -> PipelineState
+{
+    PipelineState state{};
+    state.fill = static_cast<FaceFill>(index % kFillCount);
+    index /= kFillCount;
+    state.shading = static_cast<TriangleShading>(index % kShadingCount);
+    index /= kShadingCount;
+    state.depth_tested = (index % 2) != 0;
+    index /= 2;
+    state.half_space = (index % 2) != 0;
+    index /= 2;
+    state.outlines = (index % 2) != 0;
+    index /= 2;
+    state.deferred = (index % 2) != 0;
+    return state;
+}
+
+static constexpr auto pipeline_state_index(const PipelineState& state) -> std::size_t
+{
+    std::size_t index = static_cast<std::size_t>(state.deferred);
+    index = (index * 2) + static_cast<std::size_t>(state.outlines);
+    index = (index * 2) + static_cast<std::size_t>(state.half_space);
+    index = (index * 2) + static_cast<std::size_t>(state.depth_tested);
+    index = (index * kShadingCount) + static_cast<std::size_t>(state.shading);
+    index = (index * kFillCount) + static_cast<std::size_t>(state.fill);
+    return index;
+}
+
+template<std::size_t... kIndices>
+static constexpr auto make_draw_face_table(std::index_sequence<kIndices...>) -> std::array<DrawFaceFunc, sizeof...(kIndices)>
+{
+    return { &draw_face<pipeline_state_from_index(kIndices)>... };
+}
+
+static constexpr auto kDrawFaceFuncs = make_draw_face_table(std::make_index_sequence<kPipelineStateCount>{});
+
+// The draw functions of a draw call, selected once from its flags. Faces without
+// a texture are always color filled, so they may need a different pipeline.
+struct FacePipelines final
+{
+    DrawFaceFunc untextured{ nullptr };
+    DrawFaceFunc textured{ nullptr };
+    DrawFaceFunc visibility{ nullptr }; // Set for deferred shading only.
+
+    auto is_deferred() const -> bool
+    {
+        return visibility != nullptr;
+    }
+
+    auto draw(Canvas& canvas,
+              DepthBuffer& depth_buffer,
+              const PreparedFace& prepared,
+              const std::uint32_t face_id = DepthBuffer::kNoFaceId) const -> void
+    {
+        const DrawFaceFunc draw_fn = (prepared.material.texture != &Texture::kNone) ? textured : untextured;
+        draw_fn(canvas, depth_buffer, prepared, face_id);
+    }
+};
+
+static auto select_pipelines(const DrawFlags::Type draw_flags, const ShadeModel shade_model) -> FacePipelines
+{
+    PipelineState state{
+        .shading = (shade_model == ShadeModel::kPhong) ? TriangleShading::kPhong :
+                   (shade_model == ShadeModel::kDisabled) ? TriangleShading::kNone : TriangleShading::kIntensity,
+        .depth_tested = (draw_flags & DrawFlags::kDepthTest) != 0,
+        .half_space = (draw_flags & DrawFlags::kHalfSpace) != 0,
+        .outlines = (draw_flags & DrawFlags::kOutlines) != 0
+    };
+
+    FaceFill fill = FaceFill::kNone;
+    if (draw_flags & DrawFlags::kColorFilled)
+    {
+        fill = FaceFill::kColor;
+    }
+    else if (draw_flags & DrawFlags::kTextureMapped)
+    {
+        fill = FaceFill::kTexture;
+    }
+    else if (draw_flags & DrawFlags::kWireframe)
+    {
+        fill = FaceFill::kWireframe;
+    }
+
+    FacePipelines pipelines{};
+
+    // Deferred shading needs every face to be filled and to write depth in its first pass.
+    if ((draw_flags & DrawFlags::kDeferredShading) && state.depth_tested &&
+        (fill == FaceFill::kColor || fill == FaceFill::kTexture))
+    {
+        state.deferred = true;
+        pipelines.visibility = state.half_space ? &draw_face_visibility<true> : &draw_face_visibility<false>;
+    }
+
+    state.fill = FaceFill::kColor;
+    pipelines.untextured = kDrawFaceFuncs[pipeline_state_index(state)];
+
+    state.fill = fill;
+    pipelines.textured = kDrawFaceFuncs[pipeline_state_index(state)];
+    return pipelines;
+}
+
+// Deferred shading of the faces at `face_indices`, which are also their face IDs. The first pass
+// only rasterizes depth and records the closest face of each pixel; the second lights and textures
+// the pixels each face won, so every pixel is shaded once however much the faces overlap.
+// The image is the same as drawing them in order with the regular pipelines.
+static auto draw_faces_deferred(Canvas& canvas,
+                                DepthBuffer& depth_buffer,
+                                const FacePipelines& pipelines,
+                                std::span<const PreparedFace> prepared_faces,
+                                std::span<const std::uint32_t> face_indices) -> void
+{
+    assert(pipelines.is_deferred());
+
+    depth_buffer.reset_face_ids();
+
+    for (const std::uint32_t face_idx : face_indices)
+    {
+        pipelines.visibility(canvas, depth_buffer, prepared_faces[face_idx], face_idx);
+    }
+
+    for (const std::uint32_t face_idx : face_indices)
+    {
+        pipelines.draw(canvas, depth_buffer, prepared_faces[face_idx], face_idx);
+    }
+}
+
+// ========================================================
+// Mesh 3D drawing:
+// ========================================================
+
+// draw_mesh() with the lights of params already prepared, shared by all draw calls of a scene.
+static auto draw_mesh_lit(Canvas& canvas, DepthBuffer& depth_buffer, const DrawMeshParams& params, const PreparedLights& lights) -> void
+{
+    const Mesh& mesh = params.mesh;
+    const Camera& camera = params.camera;
+
+    // Transform the bounding sphere and attempt early discard.
+    if ((params.draw_flags & DrawFlags::kClipping) &&
+        clip_mesh_bounds(camera.clipping_planes, mesh, params.model_view_mtx, params.scaling))
+    {
+        return;
+    }
+
+    TransformedMesh transformed{};
+    transform_mesh(canvas, params, transformed);
+
+    VertexLightingCache lighting_cache{};
+    const FacePipelines pipelines = select_pipelines(params.draw_flags, params.shade_model);
+
+    mesh.visit_faces([&](const auto faces)
+    {
+        // Deferred shading draws all faces twice, so they are prepared upfront.
+        // Face IDs are the face indices into the mesh.
+        if (pipelines.is_deferred())
+        {
+            const auto face_count = static_cast<std::uint32_t>(faces.size());
+            std::vector<PreparedFace> prepared_faces(face_count);
+            std::vector<std::uint32_t> visible_faces{};
+
+            for (std::uint32_t face_idx = 0; face_idx < face_count; ++face_idx)
             {
-                if (draw_flags & DrawFlags::kDepthTest)
-                {
-                    draw_shaded_textured_triangle_depth_tested(canvas,
-                                                               depth_buffer,
-                                                               projected_vert0,
-                                                               transformed_vert0.z,
-                                                               intensities[0],
-                                                               tex_coords0,
-                                                               projected_vert1,
-                                                               transformed_vert1.z,
-                                                               intensities[1],
-                                                               tex_coords1,
-                                                               projected_vert2,
-                                                               transformed_vert2.z,
-                                                               intensities[2],
-                                                               tex_coords2,
-                                                               *face.texture);
-                }
-                else
+                if (prepare_face(canvas, params, lights, transformed, faces[face_idx], lighting_cache, prepared_faces[face_idx]))
                 {
-                    draw_shaded_textured_triangle(canvas,
-                                                  projected_vert0,
-                                                  intensities[0],
-                                                  tex_coords0,
-                                                  projected_vert1,
-                                                  intensities[1],
-                                                  tex_coords1,
-                                                  projected_vert2,
-                                                  intensities[2],
-                                                  tex_coords2,
-                                                  *face.texture);
+                    visible_faces.push_back(face_idx);
                 }
             }
-            else if (shade_model == ShadeModel::kPhong)
-            {
-                auto compute_lighting_fn = [&](const Point3 point, const Vec3 normal) -> float
-                {
-                    return compute_lighting(light_model, point, normal, camera, face.specular, params.lights);
-                };
 
-                if (draw_flags & DrawFlags::kDepthTest)
-                {
-                    draw_phong_shaded_textured_triangle_depth_tested(canvas,
-                                                                     depth_buffer,
-                                                                     projected_vert0,
-                                                                     transformed_vert0.z,
-                                                                     normals[0],
-                                                                     tex_coords0,
-                                                                     projected_vert1,
-                                                                     transformed_vert1.z,
-                                                                     normals[1],
-                                                                     tex_coords1,
-                                                                     projected_vert2,
-                                                                     transformed_vert2.z,
-                                                                     normals[2],
-                                                                     tex_coords2,
-                                                                     *face.texture,
-                                                                     compute_lighting_fn);
-                }
-                else
-                {
-                    draw_phong_shaded_textured_triangle(canvas,
-                                                        projected_vert0,
-                                                        normals[0],
-                                                        tex_coords0,
-                                                        projected_vert1,
-                                                        normals[1],
-                                                        tex_coords1,
-                                                        projected_vert2,
-                                                        normals[2],
-                                                        tex_coords2,
-                                                        *face.texture,
-                                                        compute_lighting_fn);
-                }
+            draw_faces_deferred(canvas, depth_buffer, pipelines, prepared_faces, visible_faces);
+            return;
+        }
+
+        PreparedFace prepared{};
+
+        for (const auto& face : faces)
+        {
+            if (prepare_face(canvas, params, lights, transformed, face, lighting_cache, prepared))
+            {
+                pipelines.draw(canvas, depth_buffer, prepared);
             }
         }
-        else if (wireframe)
+    });
+}
+
+auto draw_mesh(Canvas& canvas, DepthBuffer& depth_buffer, const DrawMeshParams& params) -> void
+{
+    draw_mesh_lit(canvas, depth_buffer, params, prepare_lights(params.camera, params.lights));
+}
+
+// ========================================================
+// Scene faces:
+// ========================================================
+
+// Faces processed per geometry stage work item.
+constexpr std::uint32_t kFacesPerTask = 512;
+
+// Range of faces of one mesh instance, for the geometry stage.
+struct FaceRange final
+{
+    std::uint32_t instance{ 0 };
+    std::uint32_t first_face{ 0 }; // Index into the instance's mesh faces.
+    std::uint32_t face_count{ 0 };
+    std::uint32_t first_prepared{ 0 }; // Index of the first face into the scene wide arrays.
+};
+
+// Draw calls of the scene's mesh instances, for preparing the faces of the whole scene
+// before drawing any of them. Faces are numbered scene wide, in submission order.
+struct SceneDrawCalls final
+{
+    // DrawMeshParams only references its matrices, so they live here. Reserved upfront so they never move.
+    std::vector<Mat4> model_view_mtxs{};
+    std::vector<DrawMeshParams> mesh_params{};
+
+    // Filled by transform_draw_call(), one per draw call.
+    std::vector<TransformedMesh> transformed_meshes{};
+
+    PreparedLights lights{};
+
+    std::vector<FaceRange> face_ranges{};
+    std::uint32_t face_count{ 0 };
+};
+
+// Instances culled by their bounds get no draw call.
+static auto gather_draw_calls(const Scene& scene,
+                              const DrawFlags::Type draw_flags,
+                              const LightModel::Type light_model,
+                              const ShadeModel shade_model,
+                              SceneDrawCalls& draw_calls) -> void
+{
+    const Mat4 camera_mtx = scene.camera.to_mat4();
+    const std::size_t instance_count = scene.meshes_instances.size();
+
+    draw_calls.lights = prepare_lights(scene.camera, scene.lights);
+
+    draw_calls.model_view_mtxs.reserve(instance_count);
+    draw_calls.mesh_params.reserve(instance_count);
+
+    for (const Mesh::Instance& instance : scene.meshes_instances)
+    {
+        const Mat4& model_view_mtx = draw_calls.model_view_mtxs.emplace_back(camera_mtx * instance.transform.to_mat4());
+
+        // Transform the bounding sphere and attempt early discard.
+        if ((draw_flags & DrawFlags::kClipping) &&
+            clip_mesh_bounds(scene.camera.clipping_planes, instance.mesh, model_view_mtx, instance.transform.scaling))
         {
-            draw_wireframe_triangle(canvas,
-                                    projected_vert0,
-                                    projected_vert1,
-                                    projected_vert2,
-                                    face.color);
+            continue;
         }
 
-        if (draw_flags & DrawFlags::kOutlines)
+        const auto instance_idx = static_cast<std::uint32_t>(draw_calls.mesh_params.size());
+
+        draw_calls.mesh_params.push_back({
+            .mesh = instance.mesh,
+            .camera = scene.camera,
+            .lights = scene.lights,
+
+            .draw_flags = draw_flags,
+            .light_model = light_model,
+            .shade_model = shade_model,
+
+            .model_view_mtx = model_view_mtx,
+            .rotation = instance.transform.rotation,
+            .scaling = instance.transform.scaling,
+        });
+
+        const auto mesh_face_count = static_cast<std::uint32_t>(instance.mesh.face_count());
+        for (std::uint32_t first = 0; first < mesh_face_count; first += kFacesPerTask)
         {
-            const Color outline_color = face.color * 0.75f;
-            draw_line(canvas, projected_vert0, projected_vert1, outline_color);
-            draw_line(canvas, projected_vert0, projected_vert2, outline_color);
-            draw_line(canvas, projected_vert2, projected_vert1, outline_color);
+            draw_calls.face_ranges.push_back({
+                .instance = instance_idx,
+                .first_face = first,
+                .face_count = std::min(kFacesPerTask, mesh_face_count - first),
+                .first_prepared = draw_calls.face_count + first
+            });
         }
+
+        draw_calls.face_count += mesh_face_count;
     }
 }
 
+// Vertex stage of draw call `call_idx`.
+static auto transform_draw_call(const Canvas& canvas, SceneDrawCalls& draw_calls, const std::uint32_t call_idx) -> void
+{
+    transform_mesh(canvas, draw_calls.mesh_params[call_idx], draw_calls.transformed_meshes[call_idx]);
+}
+
+// Geometry stage of one face range. Each face has a fixed slot in the scene wide arrays.
+static auto prepare_face_range(const Canvas& canvas,
+                               const SceneDrawCalls& draw_calls,
+                               const FaceRange& range,
+                               std::span<PreparedFace> prepared_faces,
+                               std::span<std::uint8_t> is_visible) -> void
+{
+    const DrawMeshParams& params = draw_calls.mesh_params[range.instance];
+    const TransformedMesh& transformed = draw_calls.transformed_meshes[range.instance];
+    VertexLightingCache lighting_cache{};
+
+    params.mesh.visit_faces([&](const auto faces)
+    {
+        for (std::uint32_t i = 0; i < range.face_count; ++i)
+        {
+            const std::uint32_t prepared_idx = range.first_prepared + i;
+            is_visible[prepared_idx] = prepare_face(canvas, params, draw_calls.lights, transformed,
+                                                    faces[range.first_face + i],
+                                                    lighting_cache, prepared_faces[prepared_idx]);
+        }
+    });
+}
+
 // ========================================================
 // Scene 3D drawing:
 // ========================================================
@@ -503,7 +1077,42 @@ auto draw_scene(Canvas& canvas,
                 const LightModel::Type light_model,
                 const ShadeModel shade_model) -> void
 {
+    // Deferred shading covers the whole scene, not each mesh, so all faces are prepared first.
+    const FacePipelines pipelines = select_pipelines(draw_flags, shade_model);
+    if (pipelines.is_deferred())
+    {
+        SceneDrawCalls draw_calls{};
+        gather_draw_calls(scene, draw_flags, light_model, shade_model, draw_calls);
+
+        draw_calls.transformed_meshes.resize(draw_calls.mesh_params.size());
+        for (std::uint32_t call_idx = 0; call_idx < draw_calls.mesh_params.size(); ++call_idx)
+        {
+            transform_draw_call(canvas, draw_calls, call_idx);
+        }
+
+        std::vector<PreparedFace> prepared_faces(draw_calls.face_count);
+        std::vector<std::uint8_t> is_visible(draw_calls.face_count, 0);
+
+        for (const FaceRange& range : draw_calls.face_ranges)
+        {
+            prepare_face_range(canvas, draw_calls, range, prepared_faces, is_visible);
+        }
+
+        std::vector<std::uint32_t> visible_faces{};
+        for (std::uint32_t prepared_idx = 0; prepared_idx < draw_calls.face_count; ++prepared_idx)
+        {
+            if (is_visible[prepared_idx])
+            {
+                visible_faces.push_back(prepared_idx);
+            }
+        }
+
+        draw_faces_deferred(canvas, depth_buffer, pipelines, prepared_faces, visible_faces);
+        return;
+    }
+
     const Mat4 camera_mtx = scene.camera.to_mat4();
+    const PreparedLights lights = prepare_lights(scene.camera, scene.lights);
 
     for (const Mesh::Instance& instance : scene.meshes_instances)
     {
@@ -524,8 +1133,140 @@ auto draw_scene(Canvas& canvas,
             .scaling = instance.transform.scaling,
         };
 
-        draw_mesh(canvas, depth_buffer, params);
+        draw_mesh_lit(canvas, depth_buffer, params, lights);
+    }
+}
+
+// ========================================================
+// Parallel scene drawing:
+// ========================================================
+
+// Side of the square screen tiles faces are binned into. Each tile is drawn by a single thread.
+constexpr int kBinTileSize = 64;
+
+// Screen space bounding box of a prepared face, clamped to the canvas.
+// Covers everything the raster stage draws for it: fill, wireframe and outlines.
+// Padded horizontally by a pixel since the scanline functions step edge X values
+// in floating point, which can round one pixel past the end points.
+static auto face_screen_bounds(const Canvas& canvas, const PreparedFace& prepared) -> ScreenRect
+{
+    Point2 min = prepared.verts[0].projected;
+    Point2 max = min;
+
+    for (int v = 1; v < prepared.vert_count; ++v)
+    {
+        const Point2 p = prepared.verts[v].projected;
+        min = { std::min(min.x, p.x), std::min(min.y, p.y) };
+        max = { std::max(max.x, p.x), std::max(max.y, p.y) };
+    }
+
+    // Canvas y grows upwards, screen y downwards; see Canvas::draw_pixel().
+    const int x0 = std::max((canvas.width() / 2) + min.x - 1, 0);
+    const int x1 = std::min((canvas.width() / 2) + max.x + 1, canvas.width() - 1);
+    const int y0 = std::max((canvas.height() / 2) - max.y - 1, 0);
+    const int y1 = std::min((canvas.height() / 2) - min.y - 1, canvas.height() - 1);
+
+    return { x0, y0, x1 - x0 + 1, y1 - y0 + 1 };
+}
+
+auto draw_scene(Canvas& canvas,
+                DepthBuffer& depth_buffer,
+                const Scene& scene,
+                const DrawFlags::Type draw_flags,
+                const LightModel::Type light_model,
+                const ShadeModel shade_model,
+                ThreadPool& thread_pool) -> void
+{
+    assert(canvas.dimensions().width == depth_buffer.dimensions().width &&
+           canvas.dimensions().height == depth_buffer.dimensions().height);
+
+    SceneDrawCalls draw_calls{};
+    gather_draw_calls(scene, draw_flags, light_model, shade_model, draw_calls);
+    const std::uint32_t face_count = draw_calls.face_count;
+
+    // Vertex stage: transform each draw call's vertices once, in parallel.
+    draw_calls.transformed_meshes.resize(draw_calls.mesh_params.size());
+    thread_pool.parallel_for(static_cast<std::uint32_t>(draw_calls.mesh_params.size()), [&](const std::uint32_t call_idx, std::uint32_t) {
+        transform_draw_call(canvas, draw_calls, call_idx);
+    });
+
+    // Geometry stage: clip, cull and light all faces in parallel.
+    // Each face has a fixed slot, so submission order is kept for the raster stage.
+    std::vector<PreparedFace> prepared_faces(face_count);
+    std::vector<std::uint8_t> is_visible(face_count, 0);
+
+    thread_pool.parallel_for(static_cast<std::uint32_t>(draw_calls.face_ranges.size()), [&](const std::uint32_t range_idx, std::uint32_t) {
+        prepare_face_range(canvas, draw_calls, draw_calls.face_ranges[range_idx], prepared_faces, is_visible);
+    });
+
+    // Binning: record the faces overlapping each screen tile, in submission order.
+    const int tiles_x = (canvas.width() + kBinTileSize - 1) / kBinTileSize;
+    const int tiles_y = (canvas.height() + kBinTileSize - 1) / kBinTileSize;
+    std::vector<std::vector<std::uint32_t>> tile_bins(tiles_x * tiles_y);
+
+    for (std::uint32_t prepared_idx = 0; prepared_idx < face_count; ++prepared_idx)
+    {
+        if (!is_visible[prepared_idx])
+        {
+            continue;
+        }
+
+        const ScreenRect bounds = face_screen_bounds(canvas, prepared_faces[prepared_idx]);
+        if (bounds.width <= 0 || bounds.height <= 0)
+        {
+            continue; // Off canvas.
+        }
+
+        for (int ty = bounds.y / kBinTileSize; ty <= (bounds.y + bounds.height - 1) / kBinTileSize; ++ty)
+        {
+            for (int tx = bounds.x / kBinTileSize; tx <= (bounds.x + bounds.width - 1) / kBinTileSize; ++tx)
+            {
+                tile_bins[tx + (ty * tiles_x)].push_back(prepared_idx);
+            }
+        }
     }
+
+    const FacePipelines pipelines = select_pipelines(draw_flags, shade_model);
+
+    // Raster stage: each tile is drawn by one thread into its own slice of the canvas and depth
+    // buffer, so no pixel is ever written by two threads. Faces outside the slice are discarded by it.
+    thread_pool.parallel_for(static_cast<std::uint32_t>(tile_bins.size()), [&](const std::uint32_t tile_idx, std::uint32_t) {
+        const std::vector<std::uint32_t>& bin = tile_bins[tile_idx];
+        if (bin.empty())
+        {
+            return;
+        }
+
+        const int x = static_cast<int>(tile_idx % tiles_x) * kBinTileSize;
+        const int y = static_cast<int>(tile_idx / tiles_x) * kBinTileSize;
+
+        const ScreenRect window{
+            x,
+            y,
+            std::min(kBinTileSize, canvas.width() - x),
+            std::min(kBinTileSize, canvas.height() - y)
+        };
+
+        Canvas canvas_slice{ canvas.dimensions(), window };
+        DepthBuffer depth_slice{ depth_buffer.dimensions(), window };
+        canvas_slice.copy_window_from(canvas);
+        depth_slice.copy_window_from(depth_buffer);
+
+        if (pipelines.is_deferred())
+        {
+            draw_faces_deferred(canvas_slice, depth_slice, pipelines, prepared_faces, bin);
+        }
+        else
+        {
+            for (const std::uint32_t prepared_idx : bin)
+            {
+                pipelines.draw(canvas_slice, depth_slice, prepared_faces[prepared_idx]);
+            }
+        }
+
+        canvas_slice.copy_window_to(canvas);
+        depth_slice.copy_window_to(depth_buffer);
+    });
 }
 
 } // cgfs::rasterizer
@@ -4,6 +4,7 @@
 #include "scene.hpp"
 #include "depth_buffer.hpp"
 #include "../common/canvas.hpp"
+#include "../common/thread_pool.hpp"
 
 namespace cgfs::rasterizer
 {
@@ -20,7 +21,10 @@ struct DrawFlags final
         kDepthTest          = 1 << 5,
         kBackFaceCull       = 1 << 6,
         kClipping           = 1 << 7,
-        kComputeFaceNormals = 1 << 8 // Override model normals with a computed 'flat' face normal.
+        kComputeFaceNormals = 1 << 8, // Override model normals with a computed 'flat' face normal.
+        kHalfSpace          = 1 << 9, // Fill triangles with the edge function rasterizer instead of scanlines.
+        kDeferredShading    = 1 << 10 // Rasterize depth and face IDs first, then light and texture each visible pixel once.
+                                      // Only for depth tested, color filled or texture mapped faces; ignored otherwise.
     };
 };
 
@@ -69,4 +73,16 @@ auto draw_scene(Canvas& canvas,
                 const LightModel::Type light_model,
                 const ShadeModel shade_model) -> void;
 
+// Sort-middle parallel version of draw_scene(), with identical output:
+// faces are transformed, clipped, culled and lit in parallel, binned into screen tiles,
+// then each tile is rasterized by one thread into its own slice of the canvas and depth buffer.
+// Both triangle rasterizers only visit the pixels of the tile being drawn.
+auto draw_scene(Canvas& canvas,
+                DepthBuffer& depth_buffer,
+                const Scene& scene,
+                const DrawFlags::Type draw_flags,
+                const LightModel::Type light_model,
+                const ShadeModel shade_model,
+                ThreadPool& thread_pool) -> void;
+
 } // cgfs::rasterizer
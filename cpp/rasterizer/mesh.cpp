@@ -1,144 +1,372 @@
 #include "mesh.hpp"
+#include "../common/obj_file.hpp"
+#include "../common/mesh_cache.hpp"
 
-#include <fstream>
-#include <sstream>
-#include <iostream>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 namespace cgfs::rasterizer
 {
 
-auto load_obj_mesh_from_file(Mesh& mesh, const std::string& filename, const float vertex_scale) -> bool
+// ========================================================
+// OBJ import:
+// ========================================================
+
+// Bit pattern of a vertex position, for finding identical ones.
+struct VertexKey final
+{
+    std::array<std::uint32_t, 3> bits{};
+
+    auto operator==(const VertexKey& other) const -> bool = default;
+};
+
+struct VertexKeyHash final
 {
-    std::ifstream file{ filename };
-    if (!file.is_open())
+    auto operator()(const VertexKey& key) const -> std::size_t
     {
-        std::println(stderr, "Error: Could not open file: '{}'", filename);
-        return false;
+        std::size_t hash = key.bits[0];
+        hash = (hash * 0x9E3779B1u) ^ key.bits[1];
+        hash = (hash * 0x9E3779B1u) ^ key.bits[2];
+        return hash;
     }
+};
 
-    std::string line{};
-    while (std::getline(file, line))
+// OBJ exporters often write the position of every face corner separately, even if
+// neighboring faces share it. Merging identical positions lets those faces share
+// vertices, so the renderer transforms each of them once. Order is kept.
+static auto weld_vertices(Mesh& mesh) -> void
+{
+    std::unordered_map<VertexKey, std::uint32_t, VertexKeyHash> unique_indices{};
+    std::vector<std::uint32_t> remap(mesh.vertices.size());
+    std::vector<Point3> unique_vertices{};
+
+    unique_indices.reserve(mesh.vertices.size());
+
+    for (std::size_t v = 0; v < mesh.vertices.size(); ++v)
     {
-        std::istringstream ss{ line };
-        std::string prefix{};
-        ss >> prefix;
+        const Point3& vertex = mesh.vertices[v];
+        const VertexKey key{ std::bit_cast<std::uint32_t>(vertex.x),
+                             std::bit_cast<std::uint32_t>(vertex.y),
+                             std::bit_cast<std::uint32_t>(vertex.z) };
 
-        // Parse vertices (v)
-        if (prefix == "v")
+        const auto [it, inserted] = unique_indices.try_emplace(key, static_cast<std::uint32_t>(unique_vertices.size()));
+        if (inserted)
         {
-            Point3 v = {};
-            ss >> v.x >> v.y >> v.z;
-            mesh.vertices.push_back(v * vertex_scale);
+            unique_vertices.push_back(vertex);
         }
-        // Parse texture coordinates (vt)
-        else if (prefix == "vt")
+        remap[v] = it->second;
+    }
+
+    mesh.visit_faces([&](auto faces)
+    {
+        for (auto& face : faces)
         {
-            TexCoords tc = {};
-            ss >> tc.u >> tc.v;
-            // Flip uvs:
-            tc.v = 1.0f - tc.v;
-            mesh.tex_coords.push_back(tc);
+            for (auto& vert : face.verts)
+            {
+                vert = static_cast<std::remove_reference_t<decltype(vert)>>(remap[vert]);
+            }
         }
-        // Parse normals (vn)
-        else if (prefix == "vn")
+    });
+
+    mesh.vertices = std::move(unique_vertices);
+}
+
+// Converts large faces to the compact 16-bit form if all indices fit in it.
+static auto compact_face_indices(Mesh& mesh) -> void
+{
+    const std::size_t max_count = std::max({ mesh.vertices.size(), mesh.normals.size(), mesh.tex_coords.size() });
+    if (mesh.large_faces.empty() || max_count > std::size_t{ UINT16_MAX } + 1)
+    {
+        return;
+    }
+
+    mesh.faces.resize(mesh.large_faces.size());
+
+    for (std::size_t f = 0; f < mesh.large_faces.size(); ++f)
+    {
+        const Mesh::LargeFace& large_face = mesh.large_faces[f];
+        Mesh::Face& face = mesh.faces[f];
+
+        for (int v = 0; v < 3; ++v)
         {
-            Vec3 vn = {};
-            ss >> vn.x >> vn.y >> vn.z;
-            mesh.normals.push_back(vn);
+            face.verts[v] = static_cast<std::uint16_t>(large_face.verts[v]);
+            face.normals[v] = static_cast<std::uint16_t>(large_face.normals[v]);
+            face.tex_coords[v] = static_cast<std::uint16_t>(large_face.tex_coords[v]);
         }
-        // Parse faces (f)
-        else if (prefix == "f")
+
+        face.color = large_face.color;
+        face.specular = large_face.specular;
+        face.texture = large_face.texture;
+    }
+
+    mesh.large_faces = {};
+}
+
+auto load_obj_mesh_from_file(Mesh& mesh, const std::string& filename, const float vertex_scale, ThreadPool* thread_pool) -> bool
+{
+    ObjFile obj{};
+    if (!load_obj_file(obj, filename, vertex_scale, thread_pool))
+    {
+        return false;
+    }
+
+    mesh.vertices = std::move(obj.vertices);
+    mesh.normals = std::move(obj.normals);
+    mesh.tex_coords = std::move(obj.tex_coords);
+
+    // Flip uvs:
+    for (TexCoords& tc : mesh.tex_coords)
+    {
+        tc.v = 1.0f - tc.v;
+    }
+
+    // Faces are imported with 32-bit indices, then compacted once welding settled the vertex count.
+    mesh.faces.clear();
+    mesh.large_faces.clear();
+    mesh.large_faces.reserve(obj.faces.size());
+
+    for (const ObjFile::Face& obj_face : obj.faces)
+    {
+        Mesh::LargeFace face = {};
+
+        for (int count = 0; count < 3; ++count)
         {
-            Mesh::Face face = {};
-            std::string face_info{};
+            const ObjFile::Corner& corner = obj_face.corners[count];
 
-            // Only support triangles (3 vertices per face).
-            for (int count = 0; ss >> face_info; ++count)
+            if (corner.normal == ObjFile::kNoIndex) [[unlikely]]
             {
-                if (count >= 3) [[unlikely]]
-                {
-                    std::println(stderr, "Non-triangle OBJ model face: `{}`", face_info);
-                    return false;
-                }
-                
-                std::string face_vertex{};
-                std::string face_tex_coords{};
-                std::string face_normal{};
-
-                // `f vertex_index//normal_index`
-                if (const auto double_slash = face_info.find("//"); double_slash != std::string::npos)
-                {
-                    face_vertex = face_info.substr(0, double_slash);
-                    face_normal = face_info.substr(double_slash + 2); // +2 skips '//' separator
-                }
-                // `f vertex_index/texture_index/normal_index`
-                else if (const auto single_slash = face_info.find('/'); single_slash != std::string::npos)
-                {
-                    const auto last_slash = face_info.find_last_of('/');
-                    face_vertex = face_info.substr(0, single_slash);
-                    face_tex_coords = face_info.substr(single_slash + 1, last_slash - (single_slash + 1));
-                    face_normal = face_info.substr(last_slash + 1);
-                }
-                else [[unlikely]]
-                {
-                    std::println(stderr, "Unsupported OBJ model face format: `{}`", face_info);
-                    return false;
-                }
-
-                const int vertex_index = std::stoi(face_vertex) - 1; // Convert from 1-based to 0-based.
-                assert(vertex_index >= 0 && vertex_index <= UINT16_MAX); // 16bit indices.
-
-                // Optional tex coords.
-                const int tex_coord_index = !face_tex_coords.empty() ? (std::stoi(face_tex_coords) - 1) : 0;
-                assert(tex_coord_index >= 0 && tex_coord_index <= UINT16_MAX);
-                
-                const int normal_index = std::stoi(face_normal) - 1;
-                assert(normal_index >= 0 && normal_index <= UINT16_MAX);
-
-                face.verts[count] = static_cast<std::uint16_t>(vertex_index);
-                face.tex_coords[count] = static_cast<std::uint16_t>(tex_coord_index);
-                face.normals[count] = static_cast<std::uint16_t>(normal_index);
+                std::println(stderr, "Unsupported OBJ model face format, missing normals: '{}'", filename);
+                return false;
             }
 
-            mesh.faces.push_back(face);
+            // Optional tex coords.
+            const std::uint32_t tex_coord_index = (corner.tex_coord != ObjFile::kNoIndex) ? corner.tex_coord : 0;
+
+            if (corner.vert >= mesh.vertices.size() || corner.normal >= mesh.normals.size() ||
+                (corner.tex_coord != ObjFile::kNoIndex && corner.tex_coord >= mesh.tex_coords.size())) [[unlikely]]
+            {
+                std::println(stderr, "Out of range OBJ model face index: '{}'", filename);
+                return false;
+            }
+
+            face.verts[count] = corner.vert;
+            face.tex_coords[count] = tex_coord_index;
+            face.normals[count] = corner.normal;
         }
+
+        mesh.large_faces.push_back(face);
     }
 
+    weld_vertices(mesh);
+    compact_face_indices(mesh);
     return true;
 }
 
-auto compute_bounding_sphere(const std::vector<Point3>& points) -> Mesh::BoundingSphere
+// ========================================================
+// Mesh cache:
+// ========================================================
+
+constexpr std::uint32_t kMeshCacheLayout = 0x52415354; // "RAST"
+
+enum MeshCacheChunkId : std::uint32_t
 {
-    if (points.empty())
+    kCacheVertices,
+    kCacheNormals,
+    kCacheTexCoords,
+    kCacheFaceIndices16,
+    kCacheFaceIndices32,
+    kCacheBoundingSphere,
+};
+
+// Mesh::BasicFace without its material, which is not part of the file.
+template<typename IndexT>
+struct CachedFaceIndices final
+{
+    IndexT verts[3]{};
+    IndexT normals[3]{};
+    IndexT tex_coords[3]{};
+};
+
+template<typename IndexT>
+static auto read_cached_faces(const MeshCacheReader& cache, const std::uint32_t id, std::vector<Mesh::BasicFace<IndexT>>& faces) -> bool
+{
+    std::vector<CachedFaceIndices<IndexT>> face_indices{};
+    if (!cache.read(id, face_indices))
     {
-        return {};
+        return false;
+    }
+
+    faces.resize(face_indices.size());
+    for (std::size_t f = 0; f < face_indices.size(); ++f)
+    {
+        std::ranges::copy(face_indices[f].verts, faces[f].verts);
+        std::ranges::copy(face_indices[f].normals, faces[f].normals);
+        std::ranges::copy(face_indices[f].tex_coords, faces[f].tex_coords);
+    }
+
+    return true;
+}
+
+static auto read_mesh_cache(Mesh& mesh, const std::string& cache_filename, const MeshCacheKey& key) -> bool
+{
+    const MeshCacheReader cache{ cache_filename, key };
+    if (!cache.is_valid())
+    {
+        return false;
+    }
+
+    std::vector<Mesh::BoundingSphere> bounding_sphere{};
+
+    mesh.faces.clear();
+    mesh.large_faces.clear();
+
+    if (!cache.read(kCacheVertices, mesh.vertices) ||
+        !cache.read(kCacheNormals, mesh.normals) ||
+        !cache.read(kCacheTexCoords, mesh.tex_coords) ||
+        !(read_cached_faces(cache, kCacheFaceIndices16, mesh.faces) || read_cached_faces(cache, kCacheFaceIndices32, mesh.large_faces)) ||
+        !cache.read(kCacheBoundingSphere, bounding_sphere) || bounding_sphere.size() != 1)
+    {
+        return false;
     }
 
-    // Step 1: Find the most distant pair of points
-    Point3 p0 = points[0];
-    Point3 p1 = points[0];
-    float maxDistSq = 0.0f;
+    mesh.bounding_sphere = bounding_sphere[0];
+    return true;
+}
 
-    for (const auto& a : points)
+static auto write_mesh_cache(const Mesh& mesh, const std::string& cache_filename, const MeshCacheKey& key) -> bool
+{
+    return mesh.visit_faces([&]<typename FaceT>(const std::span<const FaceT> faces) -> bool
     {
-        for (const auto& b : points)
+        using IndexT = std::remove_extent_t<decltype(FaceT::verts)>;
+
+        std::vector<CachedFaceIndices<IndexT>> face_indices(faces.size());
+        for (std::size_t f = 0; f < faces.size(); ++f)
         {
-            const Point3 d = b - a;
-            const float distSq = dot(d, d);
-            if (distSq > maxDistSq)
+            std::ranges::copy(faces[f].verts, face_indices[f].verts);
+            std::ranges::copy(faces[f].normals, face_indices[f].normals);
+            std::ranges::copy(faces[f].tex_coords, face_indices[f].tex_coords);
+        }
+
+        MeshCacheWriter cache{};
+        cache.add<Point3>(kCacheVertices, mesh.vertices);
+        cache.add<Vec3>(kCacheNormals, mesh.normals);
+        cache.add<TexCoords>(kCacheTexCoords, mesh.tex_coords);
+        cache.add<CachedFaceIndices<IndexT>>(sizeof(IndexT) == 2 ? kCacheFaceIndices16 : kCacheFaceIndices32, face_indices);
+        cache.add<Mesh::BoundingSphere>(kCacheBoundingSphere, std::span{ &mesh.bounding_sphere, 1 });
+        return cache.write(cache_filename, key);
+    });
+}
+
+auto load_cached_mesh_from_file(Mesh& mesh, const std::string& filename, const float vertex_scale, ThreadPool* thread_pool) -> bool
+{
+    const std::string cache_filename = filename + ".raster.meshcache";
+    const MeshCacheKey key{ .source_filename = filename, .layout = kMeshCacheLayout, .vertex_scale = vertex_scale };
+
+    if (read_mesh_cache(mesh, cache_filename, key))
+    {
+        return true;
+    }
+
+    if (!load_obj_mesh_from_file(mesh, filename, vertex_scale, thread_pool))
+    {
+        return false;
+    }
+
+    mesh.bounding_sphere = (thread_pool != nullptr) ? compute_bounding_sphere(mesh.vertices, *thread_pool)
+                                                    : compute_bounding_sphere(mesh.vertices);
+
+    // Best effort: without a writable asset directory, every run imports the OBJ again.
+    write_mesh_cache(mesh, cache_filename, key);
+    return true;
+}
+
+// ========================================================
+// Bounds:
+// ========================================================
+
+// Points with the smallest and largest coordinate along each axis.
+struct AxisExtremes final
+{
+    std::array<Point3, 3> min_points{};
+    std::array<Point3, 3> max_points{};
+};
+
+static auto find_axis_extremes(const std::span<const Point3> points) -> AxisExtremes
+{
+    assert(!points.empty());
+
+    AxisExtremes extremes{};
+    extremes.min_points.fill(points[0]);
+    extremes.max_points.fill(points[0]);
+
+    for (const Point3& p : points)
+    {
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            if (p[axis] < extremes.min_points[axis][axis])
             {
-                maxDistSq = distSq;
-                p0 = a;
-                p1 = b;
+                extremes.min_points[axis] = p;
             }
+            if (p[axis] > extremes.max_points[axis][axis])
+            {
+                extremes.max_points[axis] = p;
+            }
+        }
+    }
+
+    return extremes;
+}
+
+static auto merge_axis_extremes(AxisExtremes& extremes, const AxisExtremes& other) -> void
+{
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        if (other.min_points[axis][axis] < extremes.min_points[axis][axis])
+        {
+            extremes.min_points[axis] = other.min_points[axis];
+        }
+        if (other.max_points[axis][axis] > extremes.max_points[axis][axis])
+        {
+            extremes.max_points[axis] = other.max_points[axis];
+        }
+    }
+}
+
+// Sphere through the most distant pair of extreme points.
+static auto make_initial_sphere(const AxisExtremes& extremes) -> Mesh::BoundingSphere
+{
+    std::size_t widest_axis = 0;
+    float max_dist_sq = -1.0f;
+
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        const Vec3 d = extremes.max_points[axis] - extremes.min_points[axis];
+        const float dist_sq = dot(d, d);
+        if (dist_sq > max_dist_sq)
+        {
+            max_dist_sq = dist_sq;
+            widest_axis = axis;
         }
     }
 
-    // Step 2: Initial sphere center = midpoint
-    Point3 center = (p0 + p1) / 2.0f;
-    float radius = std::sqrt(maxDistSq) / 2.0f;
+    const Point3& p0 = extremes.min_points[widest_axis];
+    const Point3& p1 = extremes.max_points[widest_axis];
+    return { (p0 + p1) / 2.0f, std::sqrt(max_dist_sq) / 2.0f };
+}
+
+// Grows the sphere just enough to include each point outside of it, moving its center towards the point.
+static auto grow_sphere(Mesh::BoundingSphere sphere, const std::span<const Point3> points) -> Mesh::BoundingSphere
+{
+    Point3& center = sphere.center;
+    float& radius = sphere.radius;
 
-    // Step 3: Grow sphere to include all points
     for (const auto& p : points)
     {
         const Point3 d = p - center;
@@ -158,7 +386,87 @@ auto compute_bounding_sphere(const std::vector<Point3>& points) -> Mesh::Boundin
         }
     }
 
-    return { center, radius };
+    return sphere;
+}
+
+// Smallest sphere enclosing both spheres.
+static auto merge_spheres(const Mesh::BoundingSphere& a, const Mesh::BoundingSphere& b) -> Mesh::BoundingSphere
+{
+    const Vec3 d = b.center - a.center;
+    const float dist = length(d);
+
+    if (dist + b.radius <= a.radius)
+    {
+        return a;
+    }
+    if (dist + a.radius <= b.radius)
+    {
+        return b;
+    }
+
+    const float radius = (dist + a.radius + b.radius) / 2.0f;
+    return { a.center + (d * ((radius - a.radius) / dist)), radius };
+}
+
+auto compute_bounding_sphere(const std::vector<Point3>& points) -> Mesh::BoundingSphere
+{
+    if (points.empty())
+    {
+        return {};
+    }
+
+    // Step 1: Initial sphere from the extreme points along each axis.
+    const Mesh::BoundingSphere initial_sphere = make_initial_sphere(find_axis_extremes(points));
+
+    // Step 2: Grow sphere to include all points.
+    return grow_sphere(initial_sphere, points);
+}
+
+// Points per work item of the parallel compute_bounding_sphere().
+constexpr std::size_t kBoundsChunkSize = 16 * 1024;
+
+auto compute_bounding_sphere(const std::vector<Point3>& points, ThreadPool& thread_pool) -> Mesh::BoundingSphere
+{
+    const std::size_t chunk_count = (points.size() + kBoundsChunkSize - 1) / kBoundsChunkSize;
+    if (chunk_count <= 1)
+    {
+        return compute_bounding_sphere(points);
+    }
+
+    const auto chunk_points = [&](const std::size_t chunk) -> std::span<const Point3>
+    {
+        const std::size_t first = chunk * kBoundsChunkSize;
+        return std::span{ points }.subspan(first, std::min(kBoundsChunkSize, points.size() - first));
+    };
+
+    // Step 1: Extreme points of each chunk, then of the whole set.
+    std::vector<AxisExtremes> chunk_extremes(chunk_count);
+    thread_pool.parallel_for(static_cast<std::uint32_t>(chunk_count), [&](const std::uint32_t chunk, std::uint32_t) {
+        chunk_extremes[chunk] = find_axis_extremes(chunk_points(chunk));
+    });
+
+    AxisExtremes extremes = chunk_extremes[0];
+    for (std::size_t chunk = 1; chunk < chunk_count; ++chunk)
+    {
+        merge_axis_extremes(extremes, chunk_extremes[chunk]);
+    }
+
+    // Step 2: Each chunk grows its own copy of the initial sphere; their union bounds every point.
+    // Merged in chunk order, so the result doesn't depend on the thread count.
+    const Mesh::BoundingSphere initial_sphere = make_initial_sphere(extremes);
+
+    std::vector<Mesh::BoundingSphere> chunk_spheres(chunk_count);
+    thread_pool.parallel_for(static_cast<std::uint32_t>(chunk_count), [&](const std::uint32_t chunk, std::uint32_t) {
+        chunk_spheres[chunk] = grow_sphere(initial_sphere, chunk_points(chunk));
+    });
+
+    Mesh::BoundingSphere sphere = chunk_spheres[0];
+    for (std::size_t chunk = 1; chunk < chunk_count; ++chunk)
+    {
+        sphere = merge_spheres(sphere, chunk_spheres[chunk]);
+    }
+
+    return sphere;
 }
 
 } // cgfs::rasterizer
@@ -6,8 +6,11 @@
 #include "../common/mat3.hpp"
 #include "../common/mat4.hpp"
 #include "../common/texcoords.hpp"
+#include "../common/thread_pool.hpp"
 #include "texture.hpp"
 
+#include <cstdint>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -44,16 +47,17 @@ struct Mesh final
         float radius{ 0.0f };
     };
 
-    struct Face final
+    template<typename IndexT>
+    struct BasicFace final
     {
         // Indices making a triangle or "face".
-        std::uint16_t verts[3]{};
+        IndexT verts[3]{};
 
         // Indices of the 3 face normals.
-        std::uint16_t normals[3]{};
+        IndexT normals[3]{};
 
         // Indices of the 3 face UV sets.
-        std::uint16_t tex_coords[3]{};
+        IndexT tex_coords[3]{};
 
         // Face material.
         Color color{};
@@ -63,19 +67,66 @@ struct Mesh final
         const Texture* texture{ &Texture::kNone };
     };
 
+    // Compact faces, for meshes with up to 65,536 vertices, normals and UVs.
+    using Face = BasicFace<std::uint16_t>;
+
+    // Faces of bigger meshes.
+    using LargeFace = BasicFace<std::uint32_t>;
+
     std::vector<Point3> vertices{};
     std::vector<Vec3> normals{};
     std::vector<TexCoords> tex_coords{};
+
+    // A mesh uses one of the two, depending on its index width.
     std::vector<Face> faces{};
+    std::vector<LargeFace> large_faces{};
+
+    auto face_count() const -> std::size_t
+    {
+        return faces.size() + large_faces.size();
+    }
+
+    // Calls `func` with a span of the faces of the mesh, whichever their index width,
+    // so loops over them are compiled once per width instead of checking it per face.
+    template<typename Func>
+    auto visit_faces(Func&& func) const -> decltype(auto)
+    {
+        if (!large_faces.empty())
+        {
+            return func(std::span<const LargeFace>{ large_faces });
+        }
+        return func(std::span<const Face>{ faces });
+    }
+
+    template<typename Func>
+    auto visit_faces(Func&& func) -> decltype(auto)
+    {
+        if (!large_faces.empty())
+        {
+            return func(std::span<LargeFace>{ large_faces });
+        }
+        return func(std::span<Face>{ faces });
+    }
 
     // For clipping.
     BoundingSphere bounding_sphere{};
 };
 
-// Simple .obj 3D model loader.
-auto load_obj_mesh_from_file(Mesh& mesh, const std::string& filename, const float vertex_scale = 1.0f) -> bool;
+// Simple .obj 3D model loader. See load_obj_file() for the optional thread pool.
+auto load_obj_mesh_from_file(Mesh& mesh, const std::string& filename, const float vertex_scale = 1.0f, ThreadPool* thread_pool = nullptr) -> bool;
+
+// load_obj_mesh_from_file() plus compute_bounding_sphere(), through a binary cache written next to
+// the .obj file (`<filename>.raster.meshcache`) on the first load. Later loads only copy the cached
+// arrays, until the .obj file changes. Face materials are left to their defaults.
+auto load_cached_mesh_from_file(Mesh& mesh, const std::string& filename, const float vertex_scale = 1.0f, ThreadPool* thread_pool = nullptr) -> bool;
 
-// Compute sphere bounds using Ritter's algorithm, simple but not necessarily the most accurate or fastest.
+// Compute sphere bounds using Ritter's algorithm in linear time: starts from the most distant pair
+// of the extreme points along each axis, then grows to include every point. Simple, but the sphere
+// is usually a few percent bigger than the minimal one.
 auto compute_bounding_sphere(const std::vector<Point3>& points) -> Mesh::BoundingSphere;
 
+// Parallel version for big point sets. Each chunk of points grows the initial sphere on its own,
+// then the chunk spheres are merged, so the result is slightly bigger than the serial one.
+auto compute_bounding_sphere(const std::vector<Point3>& points, ThreadPool& thread_pool) -> Mesh::BoundingSphere;
+
 } // cgfs::rasterizer
@@ -5,6 +5,12 @@
 #define STBI_ONLY_PNG
 #include "../external/stb_image.h"
 
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#define STB_IMAGE_RESIZE_STATIC
+#define STBIR__HEADER_FILENAME "stb_image_resize.h" // Vendored under the v1 name; it re-includes itself.
+#include "../external/stb_image_resize.h"
+
+#include <cmath>
 #include <print>
 
 namespace cgfs::rasterizer
@@ -30,14 +36,17 @@ auto Texture::load_from_file(const std::string& filename, const Filter filter) -
     m_dimensions.width = img_w;
     m_dimensions.height = img_h;
     m_filter = filter;
+    m_mip_levels.clear();
+
+    MipLevel& image = m_mip_levels.emplace_back(MipLevel{ .dimensions = m_dimensions });
 
     const std::size_t img_num_pixels = img_w * img_h;
-    m_pixels.reserve(img_num_pixels);
+    image.pixels.reserve(img_num_pixels);
 
     auto* img_cursor = img_data;
     for (std::size_t p = 0; p < img_num_pixels; p++, img_cursor += 4)
     {
-        m_pixels.push_back(RGBA_U8{
+        image.pixels.push_back(RGBA_U8{
             .r = img_cursor[0],
             .g = img_cursor[1],
             .b = img_cursor[2],
@@ -46,10 +55,96 @@ auto Texture::load_from_file(const std::string& filename, const Filter filter) -
     }
     
     stbi_image_free(img_data);
+
+    if (filter == Filter::kTrilinear && !generate_mipmaps())
+    {
+        std::println(stderr, "Error: Failed to generate mipmaps for image: '{}'", filename);
+        m_mip_levels.clear();
+        return false;
+    }
+
+    return true;
+}
+
+auto Texture::generate_mipmaps() -> bool
+{
+    assert(m_mip_levels.size() == 1);
+
+    // Each level is downsampled from the previous one rather than from the full
+    // resolution image, so the whole chain costs about a third of the image size.
+    while (m_mip_levels.back().dimensions.width > 1 || m_mip_levels.back().dimensions.height > 1)
+    {
+        const MipLevel& prev_level = m_mip_levels.back();
+
+        MipLevel level{
+            .dimensions = {
+                .width = std::max(prev_level.dimensions.width / 2, 1),
+                .height = std::max(prev_level.dimensions.height / 2, 1)
+            }
+        };
+        level.pixels.resize(level.dimensions.width * level.dimensions.height);
+
+        // Colors are linear everywhere else in the rasterizer, so no sRGB conversion here either.
+        const auto* const resized = stbir_resize_uint8_linear(
+            reinterpret_cast<const unsigned char*>(prev_level.pixels.data()), prev_level.dimensions.width, prev_level.dimensions.height, 0,
+            reinterpret_cast<unsigned char*>(level.pixels.data()), level.dimensions.width, level.dimensions.height, 0,
+            STBIR_RGBA);
+
+        if (resized == nullptr)
+        {
+            return false;
+        }
+
+        m_mip_levels.push_back(std::move(level));
+    }
+
     return true;
 }
 
-auto Texture::sample_texel(const TexCoords tex_coords) const -> Color
+auto Texture::level_of_detail(const TexCoords ddx, const TexCoords ddy) const -> float
+{
+    // Texels stepped over per pixel along each screen axis. The longest picks the level, so
+    // textures blur rather than alias where they are minified more in one direction.
+    const float width = static_cast<float>(m_dimensions.width);
+    const float height = static_cast<float>(m_dimensions.height);
+
+    const TexCoords step_x = { ddx.u * width, ddx.v * height };
+    const TexCoords step_y = { ddy.u * width, ddy.v * height };
+
+    const float step_x_sq = (step_x.u * step_x.u) + (step_x.v * step_x.v);
+    const float step_y_sq = (step_y.u * step_y.u) + (step_y.v * step_y.v);
+    const float max_step_sq = std::max(step_x_sq, step_y_sq);
+
+    // log2(sqrt(n)) = log2(n) / 2. Also maps NaN derivatives to the full resolution image.
+    return (max_step_sq > 0.0f) ? std::log2(max_step_sq) * 0.5f : 0.0f;
+}
+
+// Bilinear filtering of a mipmap level, weighting the 4 texels around the
+// sample point by distance to their centers. Edges are clamped.
+auto Texture::sample_bilinear(const MipLevel& level, const TexCoords tex_coords) -> Color
+{
+    const float x = (tex_coords.u * level.dimensions.width) - 0.5f;
+    const float y = (tex_coords.v * level.dimensions.height) - 0.5f;
+
+    const float x0 = std::floor(x);
+    const float y0 = std::floor(y);
+
+    const float fx = x - x0;
+    const float fy = y - y0;
+
+    // Only the texels left of and above the image can be negative.
+    const auto left = static_cast<std::size_t>(std::max(x0, 0.0f));
+    const auto top = static_cast<std::size_t>(std::max(y0, 0.0f));
+    const auto right = static_cast<std::size_t>(std::max(x0 + 1.0f, 0.0f));
+    const auto bottom = static_cast<std::size_t>(std::max(y0 + 1.0f, 0.0f));
+
+    const Color color_top = (texel_at(level, right, top) * fx) + (texel_at(level, left, top) * (1.0f - fx));
+    const Color color_bottom = (texel_at(level, right, bottom) * fx) + (texel_at(level, left, bottom) * (1.0f - fx));
+
+    return (color_bottom * fy) + (color_top * (1.0f - fy));
+}
+
+auto Texture::sample_texel(const TexCoords tex_coords, const float lod) const -> Color
 {
     float tx = std::clamp(tex_coords.u, 0.0f, 1.0f);
     float ty = std::clamp(tex_coords.v, 0.0f, 1.0f);
@@ -87,11 +182,22 @@ auto Texture::sample_texel(const TexCoords tex_coords) const -> Color
         }
     case Filter::kTrilinear:
         {
-            // Trilinear filtering samples the 3 best matching mipmaps for the texture
-            // coordinates with bilinear filtering, then further interpolates between
-            // the 3 chosen mipmap levels to produce the final sampled texel.
-            assert(false && "Not yet implemented! Needs mipmapping support first.");
-            return Color::kBlack;
+            // Trilinear filtering samples the 2 mipmap levels closest to the level of detail
+            // with bilinear filtering, then interpolates between them by the fraction of the level.
+            const float max_lod = static_cast<float>(m_mip_levels.size() - 1);
+            const float clamped_lod = std::clamp(lod, 0.0f, max_lod);
+
+            const auto level = static_cast<std::size_t>(clamped_lod);
+            const float fl = clamped_lod - static_cast<float>(level);
+
+            const Color color_fine = sample_bilinear(m_mip_levels[level], { tx, ty });
+            if (fl == 0.0f)
+            {
+                return color_fine; // Also the case of the smallest level.
+            }
+
+            const Color color_coarse = sample_bilinear(m_mip_levels[level + 1], { tx, ty });
+            return (color_coarse * fl) + (color_fine * (1.0f - fl));
         }
     }
 }
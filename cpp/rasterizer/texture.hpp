@@ -32,22 +32,27 @@ public:
     auto load_from_file(const std::string& filename, const Filter filter) -> bool;
 
     // Get color for a texel with filtering applied.
-    auto sample_texel(const TexCoords tex_coords) const -> Color;
+    auto sample_texel(const TexCoords tex_coords) const -> Color
+    {
+        return sample_texel(tex_coords, 0.0f);
+    }
+
+    // Same at a level of detail, which only Filter::kTrilinear uses; see level_of_detail().
+    // The other filters always sample the full resolution image.
+    auto sample_texel(const TexCoords tex_coords, const float lod) const -> Color;
+
+    // Level of detail of a pixel, given the screen space derivatives of its texture coordinates:
+    // log2 of the texels stepped over per pixel, so 0 is the full resolution image.
+    auto level_of_detail(const TexCoords ddx, const TexCoords ddy) const -> float;
 
     // Sample pixel directly without applying any filtering.
-    auto pixel_at(std::size_t x, std::size_t y) const -> Color
+    auto pixel_at(const std::size_t x, const std::size_t y) const -> Color
     {
-        x = std::min<std::size_t>(x, m_dimensions.width  - 1);
-        y = std::min<std::size_t>(y, m_dimensions.height - 1);
-        
-        const auto offset = x + (y * m_dimensions.width);
-        assert(offset < m_pixels.size());
-
-        const auto px = m_pixels[offset];
-        return Color::from_rgba_u8(px);
+        return texel_at(m_mip_levels[0], x, y);
     }
 
-    auto is_valid() const -> bool { return !m_pixels.empty() && m_dimensions.is_valid(); }
+    auto is_valid() const -> bool { return !m_mip_levels.empty() && m_dimensions.is_valid(); }
+    auto has_mipmaps() const -> bool { return m_mip_levels.size() > 1; }
     auto width() const -> int { return m_dimensions.width; }
     auto height() const -> int { return m_dimensions.height; }
     auto dimensions() const -> Dims { return m_dimensions; }
@@ -61,10 +66,35 @@ public:
     static const Texture kNone;
 
 private:
-    
+
+    struct MipLevel final
+    {
+        Dims dimensions{};
+        std::vector<RGBA_U8> pixels{};
+    };
+
+    static auto texel_at(const MipLevel& level, std::size_t x, std::size_t y) -> Color
+    {
+        x = std::min<std::size_t>(x, level.dimensions.width  - 1);
+        y = std::min<std::size_t>(y, level.dimensions.height - 1);
+
+        const auto offset = x + (y * level.dimensions.width);
+        assert(offset < level.pixels.size());
+
+        const auto px = level.pixels[offset];
+        return Color::from_rgba_u8(px);
+    }
+
+    static auto sample_bilinear(const MipLevel& level, const TexCoords tex_coords) -> Color;
+
+    auto generate_mipmaps() -> bool;
+
     Dims m_dimensions{};
     Filter m_filter{};
-    std::vector<RGBA_U8> m_pixels{};
+
+    // The full resolution image, then for Filter::kTrilinear each level
+    // half the size of the previous one, down to 1x1.
+    std::vector<MipLevel> m_mip_levels{};
 };
 
 } // cgfs::rasterizer
@@ -10,6 +10,7 @@
 #include "rasterizer/scene.hpp"
 
 #include <print>
+#include <array>
 #include <chrono>
 
 using namespace cgfs;
@@ -963,7 +964,7 @@ static auto load_demo_obj_mesh(const ObjModelId obj_id) -> Mesh
     {
         [[maybe_unused]] const bool is_loaded = s_textures[obj_id].load_from_file(
                         "assets/" + s_obj_models[obj_id].texture,
-                        Texture::Filter::kBilinear);
+                        Texture::Filter::kTrilinear);
         assert(is_loaded);
     }
 
@@ -972,22 +973,35 @@ static auto load_demo_obj_mesh(const ObjModelId obj_id) -> Mesh
     const std::string filename = "assets/" + s_obj_models[obj_id].filename;
     const float vertex_scaling = s_obj_models[obj_id].scaling;
 
-    [[maybe_unused]] const bool is_loaded = load_obj_mesh_from_file(mesh, filename, vertex_scaling);
+    [[maybe_unused]] const bool is_loaded = load_cached_mesh_from_file(mesh, filename, vertex_scaling);
     assert(is_loaded);
-
-    mesh.bounding_sphere = compute_bounding_sphere(mesh.vertices);
     
-    for (auto& face : mesh.faces)
+    mesh.visit_faces([&](const auto faces)
     {
-        face.color    = s_obj_models[obj_id].color;
-        face.specular = s_obj_models[obj_id].specular;
-        face.texture  = has_texture ? &s_textures[obj_id] : &Texture::kNone;
-    }
+        for (auto& face : faces)
+        {
+            face.color    = s_obj_models[obj_id].color;
+            face.specular = s_obj_models[obj_id].specular;
+            face.texture  = has_texture ? &s_textures[obj_id] : &Texture::kNone;
+        }
+    });
 
     return mesh;
 }
 
-static auto obj_meshes_demo(const ShadeModel shade_model) -> void
+// Loads every demo model, one per pool thread.
+static auto load_demo_obj_meshes(ThreadPool& thread_pool) -> std::array<Mesh, kObjCount>
+{
+    std::array<Mesh, kObjCount> meshes{};
+
+    thread_pool.parallel_for(kObjCount, [&](const std::uint32_t obj_id, std::uint32_t) {
+        meshes[obj_id] = load_demo_obj_mesh(static_cast<ObjModelId>(obj_id));
+    });
+
+    return meshes;
+}
+
+static auto obj_meshes_demo(ThreadPool& thread_pool, const ShadeModel shade_model) -> void
 {
     const auto start_time = std::chrono::high_resolution_clock::now();
 
@@ -1002,15 +1016,17 @@ static auto obj_meshes_demo(const ShadeModel shade_model) -> void
     DepthBuffer depth_buffer{ Dims{ 1024, 1024 } };
 
     // Declare these as statics to avoid reloading the meshes for each ShadeModel call.
-    static const Mesh s_cow_mesh    = load_demo_obj_mesh(kObj_Cow);
-    static const Mesh s_bunny_mesh  = load_demo_obj_mesh(kObj_Bunny);
-    static const Mesh s_spot_mesh   = load_demo_obj_mesh(kObj_Spot);
-    static const Mesh s_teapot_mesh = load_demo_obj_mesh(kObj_Teapot);
-    static const Mesh s_cube_mesh   = load_demo_obj_mesh(kObj_Cube);
+    static const std::array<Mesh, kObjCount> s_obj_meshes = load_demo_obj_meshes(thread_pool);
+
+    const Mesh& cow_mesh    = s_obj_meshes[kObj_Cow];
+    const Mesh& bunny_mesh  = s_obj_meshes[kObj_Bunny];
+    const Mesh& spot_mesh   = s_obj_meshes[kObj_Spot];
+    const Mesh& teapot_mesh = s_obj_meshes[kObj_Teapot];
+    const Mesh& cube_mesh   = s_obj_meshes[kObj_Cube];
 
     const Mesh::Instance mesh_instances[] = {
         {
-            .mesh = s_cow_mesh,
+            .mesh = cow_mesh,
             .transform = {
                 .translation = { -1.8f, 2.5f, 7.0f },
                 .rotation = Mat3::rotation_x(15.0f) * Mat3::rotation_y(-60.0f),
@@ -1018,7 +1034,7 @@ static auto obj_meshes_demo(const ShadeModel shade_model) -> void
             }
         },
         {
-            .mesh = s_bunny_mesh,
+            .mesh = bunny_mesh,
             .transform = {
                 .translation = { 1.5f, 1.0f, 7.5f },
                 .rotation = Mat3::rotation_x(15.0f) * Mat3::rotation_y(160.0f),
@@ -1026,7 +1042,7 @@ static auto obj_meshes_demo(const ShadeModel shade_model) -> void
             }
         },
         {
-            .mesh = s_spot_mesh,
+            .mesh = spot_mesh,
             .transform = {
                 .translation = { -1.5f, 0.0f, 7.0f },
                 .rotation = Mat3::kIdentity,
@@ -1034,7 +1050,7 @@ static auto obj_meshes_demo(const ShadeModel shade_model) -> void
             }
         },
         {
-            .mesh = s_teapot_mesh,
+            .mesh = teapot_mesh,
             .transform = {
                 .translation = { 1.5f, -1.2f, 7.0f },
                 .rotation = Mat3::rotation_y(120.0f),
@@ -1042,7 +1058,7 @@ static auto obj_meshes_demo(const ShadeModel shade_model) -> void
             }
         },
         {
-            .mesh = s_cube_mesh,
+            .mesh = cube_mesh,
             .transform = {
                 .translation = { 2.4f, 1.4f, 12.0f },
                 .rotation = Mat3::rotation_x(25.0f) * Mat3::rotation_z(-50.0f),
@@ -1087,7 +1103,8 @@ static auto obj_meshes_demo(const ShadeModel shade_model) -> void
                DrawFlags::kBackFaceCull |
                DrawFlags::kClipping,
                LightModel::kDiffuse | ((shade_model != ShadeModel::kFlat) ? LightModel::kSpecular : 0u),
-               shade_model);
+               shade_model,
+               thread_pool);
 
     [[maybe_unused]] const bool result = canvas.present();
     assert(result == true);
@@ -1099,7 +1116,7 @@ static auto obj_meshes_demo(const ShadeModel shade_model) -> void
 }
 
 // Runs several tests. Each one saves the result to a different PNG file.
-auto rasterizer_demo() -> void
+auto rasterizer_demo(ThreadPool& thread_pool) -> void
 {
     std::println("=== CGFS::rasterizer_demo() ===");
 
@@ -1125,10 +1142,10 @@ auto rasterizer_demo() -> void
     texture_mapping_demo(ShadeModel::kGouraud);
     texture_mapping_demo(ShadeModel::kPhong);
     
-    obj_meshes_demo(ShadeModel::kDisabled);
-    obj_meshes_demo(ShadeModel::kFlat);
-    obj_meshes_demo(ShadeModel::kGouraud);
-    obj_meshes_demo(ShadeModel::kPhong);
+    obj_meshes_demo(thread_pool, ShadeModel::kDisabled);
+    obj_meshes_demo(thread_pool, ShadeModel::kFlat);
+    obj_meshes_demo(thread_pool, ShadeModel::kGouraud);
+    obj_meshes_demo(thread_pool, ShadeModel::kPhong);
 
     const auto end_time = std::chrono::high_resolution_clock::now();
     const auto time_taken = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
@@ -1,3 +1,5 @@
 #pragma once
 
-auto rasterizer_demo() -> void;
+#include "common/thread_pool.hpp"
+
+auto rasterizer_demo(cgfs::ThreadPool& thread_pool) -> void;
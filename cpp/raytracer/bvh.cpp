@@ -0,0 +1,252 @@
+#include "bvh.hpp"
+
+#include <array>
+#include <algorithm>
+
+namespace cgfs::raytracer
+{
+
+// ========================================================
+// SAH binned builder:
+// ========================================================
+
+// Cost of visiting a node. Primitive intersection cost is given relative to it.
+constexpr float kTraversalCost = 1.0f;
+
+// Centroids are binned along the split axis instead of sorted, which keeps
+// the build O(n log n) at a negligible loss in tree quality.
+constexpr int kNumBins = 16;
+
+struct BuildBin final
+{
+    Aabb bounds{};
+    std::uint32_t count{ 0 };
+};
+
+struct BuildSplit final
+{
+    int axis{ -1 };
+    float position{ 0.0f };
+    float cost{ kInfinity };
+};
+
+struct BuildContext final
+{
+    std::span<const Aabb> prim_bounds;
+    std::vector<Point3> centroids;
+    std::uint32_t max_leaf_size;
+    float intersection_cost;
+    Bvh& bvh;
+};
+
+static auto compute_node_bounds(const BuildContext& ctx, const Bvh::Node& node) -> Aabb
+{
+    Aabb bounds{};
+    for (std::uint32_t i = node.first; i < node.first + node.count; ++i)
+    {
+        bounds.grow(ctx.prim_bounds[ctx.bvh.prim_indices[i]]);
+    }
+    return bounds;
+}
+
+static auto find_best_split(const BuildContext& ctx, const Bvh::Node& node) -> BuildSplit
+{
+    Aabb centroid_bounds{};
+    for (std::uint32_t i = node.first; i < node.first + node.count; ++i)
+    {
+        centroid_bounds.grow(ctx.centroids[ctx.bvh.prim_indices[i]]);
+    }
+
+    BuildSplit best{};
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float axis_min = centroid_bounds.min[axis];
+        const float axis_extent = centroid_bounds.max[axis] - axis_min;
+        if (axis_extent <= 0.0f)
+        {
+            continue; // All centroids on the same plane; can't split along this axis.
+        }
+
+        std::array<BuildBin, kNumBins> bins{};
+        const float scale = static_cast<float>(kNumBins) / axis_extent;
+
+        for (std::uint32_t i = node.first; i < node.first + node.count; ++i)
+        {
+            const std::uint32_t prim = ctx.bvh.prim_indices[i];
+            const int b = std::min(kNumBins - 1, static_cast<int>((ctx.centroids[prim][axis] - axis_min) * scale));
+            bins[b].bounds.grow(ctx.prim_bounds[prim]);
+            bins[b].count++;
+        }
+
+        // Sweep from both ends to get the area and primitive count on each side of every bin plane.
+        std::array<float, kNumBins - 1> left_area{}, right_area{};
+        std::array<std::uint32_t, kNumBins - 1> left_count{}, right_count{};
+
+        Aabb left_box{}, right_box{};
+        std::uint32_t left_sum = 0, right_sum = 0;
+
+        for (int b = 0; b < kNumBins - 1; ++b)
+        {
+            left_sum += bins[b].count;
+            left_box.grow(bins[b].bounds);
+            left_count[b] = left_sum;
+            left_area[b] = left_box.half_area();
+
+            right_sum += bins[kNumBins - 1 - b].count;
+            right_box.grow(bins[kNumBins - 1 - b].bounds);
+            right_count[kNumBins - 2 - b] = right_sum;
+            right_area[kNumBins - 2 - b] = right_box.half_area();
+        }
+
+        for (int b = 0; b < kNumBins - 1; ++b)
+        {
+            if (left_count[b] == 0 || right_count[b] == 0)
+            {
+                continue;
+            }
+
+            const float cost = (static_cast<float>(left_count[b]) * left_area[b]) +
+                               (static_cast<float>(right_count[b]) * right_area[b]);
+            if (cost < best.cost)
+            {
+                best.axis = axis;
+                best.position = axis_min + (static_cast<float>(b + 1) / scale);
+                best.cost = cost;
+            }
+        }
+    }
+
+    // Normalize to the usual SAH form so it can be compared with the leaf cost.
+    if (best.axis >= 0)
+    {
+        best.cost = kTraversalCost + ctx.intersection_cost * best.cost / node.bounds.half_area();
+    }
+
+    return best;
+}
+
+static auto subdivide(BuildContext& ctx, const std::uint32_t node_idx, const std::uint32_t depth) -> void
+{
+    // NOTE: Nodes are reserved upfront, so this reference stays valid while children are appended.
+    Bvh::Node& node = ctx.bvh.nodes[node_idx];
+
+    if (node.count <= 1 || depth >= Bvh::kMaxDepth - 1)
+    {
+        return;
+    }
+
+    const BuildSplit split = find_best_split(ctx, node);
+    const float leaf_cost = ctx.intersection_cost * static_cast<float>(node.count);
+
+    if (node.count <= ctx.max_leaf_size && (split.axis < 0 || split.cost >= leaf_cost))
+    {
+        return; // Cheaper to keep it as a leaf.
+    }
+
+    const auto first = ctx.bvh.prim_indices.begin() + node.first;
+    const auto last = first + node.count;
+    auto middle = first;
+
+    if (split.axis >= 0)
+    {
+        middle = std::partition(first, last, [&](const std::uint32_t prim) {
+            return ctx.centroids[prim][split.axis] < split.position;
+        });
+    }
+
+    // Degenerate distribution (e.g. all centroids coincide); fall back to an even split.
+    if (middle == first || middle == last)
+    {
+        middle = first + (node.count / 2);
+    }
+
+    const auto left_count = static_cast<std::uint32_t>(middle - first);
+    const auto left_idx = static_cast<std::uint32_t>(ctx.bvh.nodes.size());
+
+    Bvh::Node left{ .first = node.first, .count = left_count };
+    Bvh::Node right{ .first = node.first + left_count, .count = node.count - left_count };
+    left.bounds = compute_node_bounds(ctx, left);
+    right.bounds = compute_node_bounds(ctx, right);
+
+    ctx.bvh.nodes.push_back(left);
+    ctx.bvh.nodes.push_back(right);
+
+    node.first = left_idx;
+    node.count = 0; // Interior node now.
+
+    subdivide(ctx, left_idx, depth + 1);
+    subdivide(ctx, left_idx + 1, depth + 1);
+}
+
+// Public API.
+auto build_bvh(std::span<const Aabb> prim_bounds, const std::uint32_t max_leaf_size, const float intersection_cost) -> Bvh
+{
+    Bvh bvh{};
+
+    if (prim_bounds.empty())
+    {
+        return bvh;
+    }
+
+    const auto prim_count = static_cast<std::uint32_t>(prim_bounds.size());
+
+    BuildContext ctx{
+        .prim_bounds = prim_bounds,
+        .centroids = {},
+        .max_leaf_size = std::max(max_leaf_size, 1u),
+        .intersection_cost = intersection_cost,
+        .bvh = bvh
+    };
+
+    ctx.centroids.reserve(prim_count);
+    bvh.prim_indices.reserve(prim_count);
+
+    for (std::uint32_t i = 0; i < prim_count; ++i)
+    {
+        ctx.centroids.push_back(prim_bounds[i].center());
+        bvh.prim_indices.push_back(i);
+    }
+
+    // A binary tree with N leaves has at most 2N-1 nodes.
+    bvh.nodes.reserve((2 * prim_count) - 1);
+
+    Bvh::Node root{ .first = 0, .count = prim_count };
+    root.bounds = compute_node_bounds(ctx, root);
+    bvh.nodes.push_back(root);
+
+    subdivide(ctx, 0, 0);
+
+    bvh.nodes.shrink_to_fit();
+    return bvh;
+}
+
+auto refit_bvh(Bvh& bvh, std::span<const Aabb> prim_bounds) -> void
+{
+    assert(bvh.prim_indices.size() == prim_bounds.size());
+
+    // Children are always stored after their parent, so a reverse
+    // walk updates every node after both of its children.
+    for (auto n = static_cast<std::int64_t>(bvh.nodes.size()) - 1; n >= 0; --n)
+    {
+        Bvh::Node& node = bvh.nodes[n];
+        Aabb bounds{};
+
+        if (node.is_leaf())
+        {
+            for (std::uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                bounds.grow(prim_bounds[bvh.prim_indices[i]]);
+            }
+        }
+        else
+        {
+            bounds.grow(bvh.nodes[node.first].bounds);
+            bounds.grow(bvh.nodes[node.first + 1].bounds);
+        }
+
+        node.bounds = bounds;
+    }
+}
+
+} // cgfs::raytracer
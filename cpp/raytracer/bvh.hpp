@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../common/aabb.hpp"
+
+#include <cstdint>
+#include <vector>
+#include <span>
+
+namespace cgfs::raytracer
+{
+
+// Bounding volume hierarchy built with the Surface Area Heuristic (SAH).
+// The tree is stored flattened: the two children of an interior node are
+// always adjacent in `nodes`, so each node only stores the index of the first one.
+// Primitives are never moved; leaves reference ranges of `prim_indices` instead.
+struct Bvh final
+{
+    struct Node final
+    {
+        Aabb bounds{};
+        std::uint32_t first{ 0 }; // Left child index for interior nodes, first prim_indices entry for leaves.
+        std::uint32_t count{ 0 }; // Number of primitives in a leaf; 0 for interior nodes.
+
+        auto is_leaf() const -> bool { return count != 0; }
+    };
+
+    static constexpr std::uint32_t kMaxLeafSize = 4;
+    static constexpr std::uint32_t kMaxDepth = 64; // Also the traversal stack size.
+
+    std::vector<Node> nodes{};
+    std::vector<std::uint32_t> prim_indices{};
+
+    auto is_empty() const -> bool { return nodes.empty(); }
+    auto root_bounds() const -> Aabb { return !nodes.empty() ? nodes[0].bounds : Aabb{}; }
+};
+
+// Builds a BVH over the given primitive bounding boxes. Index `i` in the
+// resulting prim_indices refers back to `prim_bounds[i]`.
+// `intersection_cost` is the cost of testing one primitive relative to visiting
+// a node; lower values make the SAH favor bigger leaves, up to `max_leaf_size`.
+auto build_bvh(std::span<const Aabb> prim_bounds,
+               const std::uint32_t max_leaf_size = Bvh::kMaxLeafSize,
+               const float intersection_cost = 1.0f) -> Bvh;
+
+// Recomputes the node bounds bottom-up from updated primitive bounds.
+// Topology is kept, so `prim_bounds` must describe the same primitives used to build the tree.
+auto refit_bvh(Bvh& bvh, std::span<const Aabb> prim_bounds) -> void;
+
+} // cgfs::raytracer
@@ -2,8 +2,10 @@
 
 #include <array>
 #include <utility>
+#include <algorithm>
+#include <chrono>
 #include <optional>
-#include <future>
+#include <vector>
 
 namespace cgfs::raytracer
 {
@@ -26,6 +28,7 @@ struct ClosestIntersection final
     const Material& material;
     Point3 point{};
     Vec3 normal{};
+    std::uint32_t object{}; // Top-level BVH primitive index of the object hit.
 };
 
 static auto reflect(const Vec3 ray_direction, const Vec3 normal) -> Vec3
@@ -71,86 +74,66 @@ static auto fresnel_reflection(const Vec3 ray_direction, const Vec3 normal, cons
 // Sphere raytracing:
 // ========================================================
 
-// Computes the intersection of a ray and a sphere. Returns the values of t for the intersections.
-static auto intersect_ray_sphere(const Ray& ray, const Sphere& sphere) -> std::array<float, 2>
+struct SphereHit final
 {
-    const Vec3 oc = ray.origin - sphere.center;
-
-    const float k1 = dot(ray.direction, ray.direction);
-    const float k2 = 2.0f * dot(oc, ray.direction);
-    const float k3 = dot(oc, oc) - sphere.radius.squared;
-
-    const float discriminant = (k2 * k2) - (4.0f * k1 * k3);
-    if (discriminant < 0.0f)
-    {
-        return { kInfinity, kInfinity };
-    }
-
-    const float discriminant_sqrt = std::sqrt(discriminant);
-    const float t0 = (-k2 + discriminant_sqrt) / (2.0f * k1);
-    const float t1 = (-k2 - discriminant_sqrt) / (2.0f * k1);
-    return { t0, t1 };
-}
+    float t{ kInfinity };
+    std::uint32_t slot{ 0 }; // SphereSoA slot of the sphere hit.
+};
 
-static auto closest_sphere_intersection(const Ray& ray,
-                                        std::span<const Sphere> spheres) -> std::optional<ClosestIntersection>
+// Tests one ray against the spheres in SoA slots [first, first + count), SphereSoA::kLanes
+// at a time, and returns the nearest hit within the ray's range (t=kInfinity if none).
+// Each lane solves the ray-sphere quadratic for its two values of t, without branches
+// so the loop vectorizes. Mesh and padding slots have a negative radius and always miss.
+static auto intersect_ray_spheres_soa(const Ray& ray, const SphereSoA& soa,
+                                      const std::uint32_t first, const std::uint32_t count) -> SphereHit
 {
-    float closest_t = kInfinity;
-    const Sphere* closest_sphere = nullptr;
+    constexpr std::uint32_t kLanes = SphereSoA::kLanes;
+    assert(first + count + kLanes <= soa.radius_squared.size());
 
-    // We must iterate every sphere in the scene and find the
-    // closest one since they are not ordered by distance from the camera.
-    for (const Sphere& sphere : spheres)
+    const float k1 = dot(ray.direction, ray.direction);
+    SphereHit closest_hit{};
+
+    for (std::uint32_t base = first; base < first + count; base += kLanes)
     {
-        const auto ts = intersect_ray_sphere(ray, sphere);
+        std::array<float, kLanes> lane_t;
 
-        if (ts[0] < closest_t && ray.min_t < ts[0] && ts[0] < ray.max_t)
-        {
-            closest_t = ts[0];
-            closest_sphere = &sphere;
-        }
-        
-        if (ts[1] < closest_t && ray.min_t < ts[1] && ts[1] < ray.max_t)
+        for (std::uint32_t i = 0; i < kLanes; ++i)
         {
-            closest_t = ts[1];
-            closest_sphere = &sphere;
-        }
-    }
+            const float oc_x = ray.origin.x - soa.center_x[base + i];
+            const float oc_y = ray.origin.y - soa.center_y[base + i];
+            const float oc_z = ray.origin.z - soa.center_z[base + i];
 
-    if (closest_sphere == nullptr)
-    {
-        return std::nullopt; // No intersection.
-    }
+            const float k2 = 2.0f * ((oc_x * ray.direction.x) + (oc_y * ray.direction.y) + (oc_z * ray.direction.z));
+            const float k3 = ((oc_x * oc_x) + (oc_y * oc_y) + (oc_z * oc_z)) - soa.radius_squared[base + i];
 
-    const Point3 point = ray.origin + (ray.direction * closest_t);
-    const Vec3 normal = normalize(point - closest_sphere->center);
+            const float discriminant = (k2 * k2) - (4.0f * k1 * k3);
+            const float discriminant_sqrt = std::sqrt(std::max(discriminant, 0.0f));
+            const float t0 = (-k2 + discriminant_sqrt) / (2.0f * k1);
+            const float t1 = (-k2 - discriminant_sqrt) / (2.0f * k1);
 
-    return std::make_optional<ClosestIntersection>({
-        .material = closest_sphere->material,
-        .point = point,
-        .normal = normal
-    });
-}
+            // NOTE: Bitwise & instead of && keeps the loop free of branches.
+            const bool t0_in_range = (ray.min_t < t0) & (t0 < ray.max_t);
+            const bool t1_in_range = (ray.min_t < t1) & (t1 < ray.max_t);
 
-static auto is_obstructed_by_sphere(const Ray& ray,
-                                    std::span<const Sphere> spheres) -> bool
-{
-    for (const Sphere& sphere : spheres)
-    {
-        const auto ts = intersect_ray_sphere(ray, sphere);
+            float t = t0_in_range ? t0 : kInfinity;
+            t = (t1_in_range & (t1 < t)) ? t1 : t;
 
-        if (ray.min_t < ts[0] && ts[0] < ray.max_t)
-        {
-            return true;
+            const bool is_valid = (discriminant >= 0.0f) & (soa.radius_squared[base + i] >= 0.0f);
+            lane_t[i] = is_valid ? t : kInfinity;
         }
-        
-        if (ray.min_t < ts[1] && ts[1] < ray.max_t)
+
+        // Horizontal min. Lanes past the end of the range belong to the next leaf.
+        const std::uint32_t lane_count = std::min(kLanes, first + count - base);
+        for (std::uint32_t i = 0; i < lane_count; ++i)
         {
-            return true;
+            if (lane_t[i] < closest_hit.t)
+            {
+                closest_hit = { .t = lane_t[i], .slot = base + i };
+            }
         }
     }
 
-    return false;
+    return closest_hit;
 }
 
 // ========================================================
@@ -243,110 +226,656 @@ static auto intersect_ray_triangle(const Ray& ray,
     });
 }
 
-static auto closest_mesh_intersection(const Ray& ray,
-                                      std::span<const Mesh> meshes) -> std::optional<ClosestIntersection>
+
+// Tests a single mesh face. Returns the hit distance if it lies within the ray's (min_t, max_t) range.
+template<typename FaceT>
+static auto intersect_ray_face(const Ray& ray, const Mesh& mesh, const FaceT& face) -> std::optional<float>
 {
-    float closest_t = kInfinity;
-    Vec3 closest_normal = {};
-    const Mesh* closest_mesh = nullptr;
+    const Point3& vert0 = mesh.vertices[face.verts[0]];
+    const Point3& vert1 = mesh.vertices[face.verts[1]];
+    const Point3& vert2 = mesh.vertices[face.verts[2]];
 
-    for (const Mesh& mesh : meshes)
+    if (const auto result = intersect_ray_triangle(ray, vert0, vert1, vert2))
     {
-        for (const Mesh::Face& face : mesh.faces)
+        if (ray.min_t < result->distance && result->distance < ray.max_t)
+        {
+            return result->distance;
+        }
+    }
+
+    return std::nullopt;
+}
+
+// ========================================================
+// BVH traversal:
+// ========================================================
+
+static auto inverse_direction(const Ray& ray) -> Vec3
+{
+    return { 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+}
+
+// Front-to-back closest-hit walk. `test_leaf(leaf)` must intersect the primitives of the
+// leaf node and lower `closest_t` on a hit; subtrees farther than `closest_t` are then skipped.
+template<typename TestLeafFunc>
+static auto traverse_bvh_closest(const Bvh& bvh, const Ray& ray, const Vec3 inv_direction,
+                                 const float& closest_t, TestLeafFunc&& test_leaf) -> void
+{
+    if (bvh.is_empty())
+    {
+        return;
+    }
+
+    const auto& nodes = bvh.nodes;
+
+    // Nodes still to visit, paired with their entry distance so they can be
+    // skipped once a closer hit has been found.
+    struct StackEntry final
+    {
+        std::uint32_t node;
+        float t_enter;
+    };
+
+    std::array<StackEntry, Bvh::kMaxDepth> stack;
+    int stack_size = 0;
+
+    const float root_t = intersect_ray_aabb(nodes[0].bounds, ray.origin, inv_direction, ray.min_t, std::min(ray.max_t, closest_t));
+    if (root_t != kInfinity)
+    {
+        stack[stack_size++] = { 0, root_t };
+    }
+
+    while (stack_size > 0)
+    {
+        const StackEntry entry = stack[--stack_size];
+        if (entry.t_enter >= closest_t)
+        {
+            continue;
+        }
+
+        const Bvh::Node& node = nodes[entry.node];
+
+        if (node.is_leaf())
+        {
+            test_leaf(node);
+            continue;
+        }
+
+        const float max_t = std::min(ray.max_t, closest_t);
+        StackEntry near = { node.first, intersect_ray_aabb(nodes[node.first].bounds, ray.origin, inv_direction, ray.min_t, max_t) };
+        StackEntry far = { node.first + 1, intersect_ray_aabb(nodes[node.first + 1].bounds, ray.origin, inv_direction, ray.min_t, max_t) };
+
+        if (far.t_enter < near.t_enter)
         {
-            const Point3& vert0 = mesh.vertices[face.verts[0]];
-            const Point3& vert1 = mesh.vertices[face.verts[1]];
-            const Point3& vert2 = mesh.vertices[face.verts[2]];
+            std::swap(near, far);
+        }
+
+        // Push the far child first so the near one is visited next.
+        if (far.t_enter != kInfinity)
+        {
+            stack[stack_size++] = far;
+        }
+        if (near.t_enter != kInfinity)
+        {
+            stack[stack_size++] = near;
+        }
+    }
+}
+
+// Any-hit walk: returns true as soon as `test_leaf(leaf)` reports a hit.
+template<typename TestLeafFunc>
+static auto traverse_bvh_any(const Bvh& bvh, const Ray& ray, const Vec3 inv_direction,
+                             TestLeafFunc&& test_leaf) -> bool
+{
+    if (bvh.is_empty())
+    {
+        return false;
+    }
+
+    const auto& nodes = bvh.nodes;
+
+    std::array<std::uint32_t, Bvh::kMaxDepth> stack;
+    int stack_size = 0;
 
-            if (const auto result = intersect_ray_triangle(ray, vert0, vert1, vert2))
+    if (intersect_ray_aabb(nodes[0].bounds, ray.origin, inv_direction, ray.min_t, ray.max_t) != kInfinity)
+    {
+        stack[stack_size++] = 0;
+    }
+
+    while (stack_size > 0)
+    {
+        const Bvh::Node& node = nodes[stack[--stack_size]];
+
+        if (node.is_leaf())
+        {
+            if (test_leaf(node))
             {
-                if (result->distance < closest_t &&
-                    ray.min_t < result->distance && result->distance < ray.max_t)
-                {
-                    closest_t = result->distance;
-                    closest_normal = mesh.normals[face.normal];
-                    closest_mesh = &mesh;
+                return true;
+            }
+            continue;
+        }
 
-                    // Prevent null normals.
-                    assert(!is_zero(closest_normal));
-                    break;
-                }
+        // Visit order doesn't matter for any-hit queries.
+        for (std::uint32_t child = node.first; child < node.first + 2; ++child)
+        {
+            if (intersect_ray_aabb(nodes[child].bounds, ray.origin, inv_direction, ray.min_t, ray.max_t) != kInfinity)
+            {
+                stack[stack_size++] = child;
             }
         }
     }
 
-    if (closest_mesh == nullptr)
+    return false;
+}
+
+constexpr std::uint32_t kNoFace = ~0u;
+
+// Finds the closest face of the mesh hit by the ray that is nearer than `closest_t`.
+// Updates `closest_t` and returns the face index, or kNoFace if nothing closer was found.
+static auto closest_mesh_face(const Ray& ray, const Vec3 inv_direction,
+                              const Mesh& mesh, float& closest_t) -> std::uint32_t
+{
+    return mesh.visit_faces([&](const auto faces) -> std::uint32_t
     {
-        return std::nullopt; // No intersection.
-    }
+        std::uint32_t closest_face = kNoFace;
 
-    const Point3 point = ray.origin + (ray.direction * closest_t);
+        auto test_face = [&](const std::uint32_t face_idx)
+        {
+            if (const auto distance = intersect_ray_face(ray, mesh, faces[face_idx]); distance && *distance < closest_t)
+            {
+                closest_t = *distance;
+                closest_face = face_idx;
+            }
+        };
 
-    return std::make_optional<ClosestIntersection>({
-        .material = closest_mesh->material,
-        .point = point,
-        .normal = closest_normal
+        if (mesh.bvh.is_empty())
+        {
+            // No BVH built, test every face.
+            for (std::uint32_t face_idx = 0; face_idx < faces.size(); ++face_idx)
+            {
+                test_face(face_idx);
+            }
+        }
+        else
+        {
+            traverse_bvh_closest(mesh.bvh, ray, inv_direction, closest_t, [&](const Bvh::Node& leaf)
+            {
+                for (std::uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i)
+                {
+                    test_face(mesh.bvh.prim_indices[i]);
+                }
+            });
+        }
+
+        return closest_face;
     });
 }
 
-static auto is_obstructed_by_mesh(const Ray& ray,
-                                  std::span<const Mesh> meshes) -> bool
+// Returns as soon as any face of the mesh blocks the ray.
+static auto is_mesh_hit(const Ray& ray, const Vec3 inv_direction, const Mesh& mesh) -> bool
 {
-    for (const Mesh& mesh : meshes)
+    return mesh.visit_faces([&](const auto faces) -> bool
     {
-        for (const Mesh::Face& face : mesh.faces)
+        auto test_face = [&](const std::uint32_t face_idx) -> bool
         {
-            const Point3& vert0 = mesh.vertices[face.verts[0]];
-            const Point3& vert1 = mesh.vertices[face.verts[1]];
-            const Point3& vert2 = mesh.vertices[face.verts[2]];
+            return intersect_ray_face(ray, mesh, faces[face_idx]).has_value();
+        };
 
-            if (const auto result = intersect_ray_triangle(ray, vert0, vert1, vert2))
+        if (mesh.bvh.is_empty())
+        {
+            for (std::uint32_t face_idx = 0; face_idx < faces.size(); ++face_idx)
             {
-                if (ray.min_t < result->distance && result->distance < ray.max_t)
+                if (test_face(face_idx))
                 {
                     return true;
                 }
             }
+            return false;
         }
-    }
 
-    return false;
+        return traverse_bvh_any(mesh.bvh, ray, inv_direction, [&](const Bvh::Node& leaf) -> bool
+        {
+            for (std::uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i)
+            {
+                if (test_face(mesh.bvh.prim_indices[i]))
+                {
+                    return true;
+                }
+            }
+            return false;
+        });
+    });
 }
 
 // ========================================================
 // Generic intersection testing:
 // ========================================================
 
+constexpr std::uint32_t kNoObject = ~0u;
+
+// Surface info for a hit at distance `t` on a scene object (a top-level BVH primitive index).
+// `face_idx` is the face that was hit when the object is a mesh.
+static auto make_intersection(const Ray& ray, const Scene& scene, const float t,
+                              const std::uint32_t object, const std::uint32_t face_idx) -> ClosestIntersection
+{
+    const SceneBvh& scene_bvh = *scene.bvh;
+    const Point3 point = ray.origin + (ray.direction * t);
+
+    if (object < scene_bvh.num_spheres)
+    {
+        const Sphere& sphere = scene.spheres[object];
+
+        return {
+            .material = sphere.material,
+            .point = point,
+            .normal = normalize(point - sphere.center),
+            .object = object
+        };
+    }
+
+    assert(face_idx != kNoFace);
+    const Mesh& mesh = scene.meshes[object - scene_bvh.num_spheres];
+    const Vec3 normal = mesh.visit_faces([&](const auto faces) { return mesh.normals[faces[face_idx].normal]; });
+
+    // Prevent null normals.
+    assert(!is_zero(normal));
+
+    return {
+        .material = mesh.material,
+        .point = point,
+        .normal = normal,
+        .object = object
+    };
+}
+
 // Find the closest intersection between a ray and the objects in the scene.
+// Walks the top-level BVH; meshes reached by it continue into their own BVH.
 static auto closest_intersection(const Ray& ray, const Scene& scene) -> std::optional<ClosestIntersection>
 {
-    if (const auto result = closest_sphere_intersection(ray, scene.spheres))
+    assert(scene.bvh != nullptr);
+    const SceneBvh& scene_bvh = *scene.bvh;
+    const Vec3 inv_direction = inverse_direction(ray);
+
+    float closest_t = kInfinity;
+    std::uint32_t closest_object = kNoObject;
+    std::uint32_t closest_face = kNoFace;
+
+    traverse_bvh_closest(scene_bvh.bvh, ray, inv_direction, closest_t, [&](const Bvh::Node& leaf)
     {
-        return result;
+        // All spheres of the leaf at once, then the meshes one by one.
+        if (const SphereHit hit = intersect_ray_spheres_soa(ray, scene_bvh.sphere_soa, leaf.first, leaf.count);
+            hit.t < closest_t)
+        {
+            closest_t = hit.t;
+            closest_object = scene_bvh.sphere_soa.sphere_index[hit.slot];
+        }
+
+        for (std::uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i)
+        {
+            const std::uint32_t object = scene_bvh.bvh.prim_indices[i];
+            if (object < scene_bvh.num_spheres)
+            {
+                continue;
+            }
+
+            const Mesh& mesh = scene.meshes[object - scene_bvh.num_spheres];
+            if (const std::uint32_t face_idx = closest_mesh_face(ray, inv_direction, mesh, closest_t); face_idx != kNoFace)
+            {
+                closest_face = face_idx;
+                closest_object = object;
+            }
+        }
+    });
+
+    if (closest_object == kNoObject)
+    {
+        return std::nullopt; // No intersection.
     }
-    
-    if (const auto result = closest_mesh_intersection(ray, scene.meshes))
+
+    return make_intersection(ray, scene, closest_t, closest_object, closest_face);
+}
+
+// Last object found blocking each light, tested first by the next shadow ray towards that
+// light, since neighboring points are usually shadowed by the same object. Entries are
+// top-level BVH slots (positions in SceneBvh::bvh.prim_indices), or kNoObject.
+// Owned by a single thread for the duration of one tile.
+struct ShadowCache final
+{
+    std::vector<std::uint32_t> last_occluder{};
+
+    explicit ShadowCache(const Scene& scene)
+        : last_occluder(scene.lights.size(), kNoObject)
     {
-        return result;
     }
-    
-    return std::nullopt; // No intersection.
+};
+
+// Tests the single top-level object in BVH slot `slot`.
+static auto is_slot_hit(const Ray& ray, const Vec3 inv_direction, const Scene& scene, const std::uint32_t slot) -> bool
+{
+    const SceneBvh& scene_bvh = *scene.bvh;
+    const std::uint32_t object = scene_bvh.bvh.prim_indices[slot];
+
+    if (object < scene_bvh.num_spheres)
+    {
+        return intersect_ray_spheres_soa(ray, scene_bvh.sphere_soa, slot, 1).t != kInfinity;
+    }
+
+    return is_mesh_hit(ray, inv_direction, scene.meshes[object - scene_bvh.num_spheres]);
+}
+
+// Check if ray is obstructed by any of the scene objects, to decide if a point is in shadow.
+// `last_occluder` is the cached blocker for this light; it is tried first and updated on a new hit.
+static auto is_obstructed(const Ray& ray, const Scene& scene, std::uint32_t& last_occluder) -> bool
+{
+    assert(scene.bvh != nullptr);
+    const SceneBvh& scene_bvh = *scene.bvh;
+    const Vec3 inv_direction = inverse_direction(ray);
+
+    if (last_occluder != kNoObject && is_slot_hit(ray, inv_direction, scene, last_occluder))
+    {
+        return true;
+    }
+
+    return traverse_bvh_any(scene_bvh.bvh, ray, inv_direction, [&](const Bvh::Node& leaf) -> bool
+    {
+        if (const SphereHit hit = intersect_ray_spheres_soa(ray, scene_bvh.sphere_soa, leaf.first, leaf.count);
+            hit.t != kInfinity)
+        {
+            last_occluder = hit.slot;
+            return true;
+        }
+
+        for (std::uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i)
+        {
+            const std::uint32_t object = scene_bvh.bvh.prim_indices[i];
+            if (object >= scene_bvh.num_spheres &&
+                is_mesh_hit(ray, inv_direction, scene.meshes[object - scene_bvh.num_spheres]))
+            {
+                last_occluder = i;
+                return true;
+            }
+        }
+
+        return false;
+    });
+}
+
+// ========================================================
+// Packet intersection testing:
+// ========================================================
+
+// Bundle of N coherent rays in structure-of-arrays layout. The per-lane loops
+// below have no cross-lane dependencies, so the compiler can map them onto
+// SIMD registers (SSE/AVX on x86, NEON on ARM) without target-specific code.
+template<int N>
+struct RayPacket final
+{
+    alignas(64) std::array<float, N> origin_x{};
+    alignas(64) std::array<float, N> origin_y{};
+    alignas(64) std::array<float, N> origin_z{};
+    alignas(64) std::array<float, N> dir_x{};
+    alignas(64) std::array<float, N> dir_y{};
+    alignas(64) std::array<float, N> dir_z{};
+    alignas(64) std::array<float, N> inv_dir_x{};
+    alignas(64) std::array<float, N> inv_dir_y{};
+    alignas(64) std::array<float, N> inv_dir_z{};
+    alignas(64) std::array<float, N> min_t{};
+};
+
+// Closest hit found so far for each lane of a packet. `t` also acts as the upper
+// bound of the lane's ray range, so a lane with t=-kInfinity is masked off entirely.
+template<int N>
+struct PacketHits final
+{
+    alignas(64) std::array<float, N> t{};
+    alignas(64) std::array<std::uint32_t, N> object{};
+    alignas(64) std::array<std::uint32_t, N> face{};
+};
+
+template<int N>
+static auto make_ray_packet(const std::array<Ray, N>& rays) -> RayPacket<N>
+{
+    RayPacket<N> packet{};
+
+    for (int i = 0; i < N; ++i)
+    {
+        const Vec3 inv_direction = inverse_direction(rays[i]);
+
+        packet.origin_x[i] = rays[i].origin.x;
+        packet.origin_y[i] = rays[i].origin.y;
+        packet.origin_z[i] = rays[i].origin.z;
+        packet.dir_x[i] = rays[i].direction.x;
+        packet.dir_y[i] = rays[i].direction.y;
+        packet.dir_z[i] = rays[i].direction.z;
+        packet.inv_dir_x[i] = inv_direction.x;
+        packet.inv_dir_y[i] = inv_direction.y;
+        packet.inv_dir_z[i] = inv_direction.z;
+        packet.min_t[i] = rays[i].min_t;
+    }
+
+    return packet;
+}
+
+// Slab test for every lane. Returns the nearest entry distance among the lanes
+// that hit the box before their current closest hit, or kInfinity if none does.
+template<int N>
+static auto intersect_packet_aabb(const Aabb& box, const RayPacket<N>& packet, const PacketHits<N>& hits) -> float
+{
+    float packet_t_enter = kInfinity;
+
+    for (int i = 0; i < N; ++i)
+    {
+        const float tx0 = (box.min.x - packet.origin_x[i]) * packet.inv_dir_x[i];
+        const float tx1 = (box.max.x - packet.origin_x[i]) * packet.inv_dir_x[i];
+        const float ty0 = (box.min.y - packet.origin_y[i]) * packet.inv_dir_y[i];
+        const float ty1 = (box.max.y - packet.origin_y[i]) * packet.inv_dir_y[i];
+        const float tz0 = (box.min.z - packet.origin_z[i]) * packet.inv_dir_z[i];
+        const float tz1 = (box.max.z - packet.origin_z[i]) * packet.inv_dir_z[i];
+
+        const float t_enter = std::max({ std::min(tx0, tx1), std::min(ty0, ty1), std::min(tz0, tz1), packet.min_t[i] });
+        const float t_exit  = std::min({ std::max(tx0, tx1), std::max(ty0, ty1), std::max(tz0, tz1), hits.t[i] });
+
+        packet_t_enter = (t_enter <= t_exit) ? std::min(packet_t_enter, t_enter) : packet_t_enter;
+    }
+
+    return packet_t_enter;
+}
+
+// Same math as intersect_ray_spheres_soa(), with the lanes being rays instead of
+// spheres. Lanes that miss are simply left unchanged.
+template<int N>
+static auto intersect_packet_sphere(const RayPacket<N>& packet, const Sphere& sphere,
+                                    const std::uint32_t object, PacketHits<N>& hits) -> void
+{
+    for (int i = 0; i < N; ++i)
+    {
+        const float oc_x = packet.origin_x[i] - sphere.center.x;
+        const float oc_y = packet.origin_y[i] - sphere.center.y;
+        const float oc_z = packet.origin_z[i] - sphere.center.z;
+
+        const float d_x = packet.dir_x[i];
+        const float d_y = packet.dir_y[i];
+        const float d_z = packet.dir_z[i];
+
+        const float k1 = (d_x * d_x) + (d_y * d_y) + (d_z * d_z);
+        const float k2 = 2.0f * ((oc_x * d_x) + (oc_y * d_y) + (oc_z * d_z));
+        const float k3 = ((oc_x * oc_x) + (oc_y * oc_y) + (oc_z * oc_z)) - sphere.radius.squared;
+
+        const float discriminant = (k2 * k2) - (4.0f * k1 * k3);
+        const float discriminant_sqrt = std::sqrt(std::max(discriminant, 0.0f));
+        const float t0 = (-k2 + discriminant_sqrt) / (2.0f * k1);
+        const float t1 = (-k2 - discriminant_sqrt) / (2.0f * k1);
+
+        const float max_t = hits.t[i];
+        const bool t0_in_range = (packet.min_t[i] < t0) & (t0 < max_t);
+        const bool t1_in_range = (packet.min_t[i] < t1) & (t1 < max_t);
+
+        float t = t0_in_range ? t0 : max_t;
+        t = (t1_in_range & (t1 < t)) ? t1 : t;
+
+        const bool hit = (discriminant >= 0.0f) & (t0_in_range | t1_in_range);
+        hits.t[i] = hit ? t : max_t;
+        hits.object[i] = hit ? object : hits.object[i];
+    }
+}
+
+// Same math as intersect_ray_triangle() + intersect_ray_face(), with the
+// determinant sign cases folded into a per-lane mask.
+template<int N, typename FaceT>
+static auto intersect_packet_face(const RayPacket<N>& packet, const Mesh& mesh, std::span<const FaceT> faces,
+                                  const std::uint32_t face_idx, const std::uint32_t object, PacketHits<N>& hits) -> void
+{
+    const FaceT& face = faces[face_idx];
+    const Point3& vert0 = mesh.vertices[face.verts[0]];
+    const Vec3 edge1 = mesh.vertices[face.verts[1]] - vert0;
+    const Vec3 edge2 = mesh.vertices[face.verts[2]] - vert0;
+
+    for (int i = 0; i < N; ++i)
+    {
+        const float d_x = packet.dir_x[i];
+        const float d_y = packet.dir_y[i];
+        const float d_z = packet.dir_z[i];
+
+        // p = cross(direction, edge2)
+        const float p_x = (d_y * edge2.z) - (d_z * edge2.y);
+        const float p_y = (d_z * edge2.x) - (d_x * edge2.z);
+        const float p_z = (d_x * edge2.y) - (d_y * edge2.x);
+
+        const float det = (edge1.x * p_x) + (edge1.y * p_y) + (edge1.z * p_z);
+
+        const float dist_x = packet.origin_x[i] - vert0.x;
+        const float dist_y = packet.origin_y[i] - vert0.y;
+        const float dist_z = packet.origin_z[i] - vert0.z;
+
+        const float u = (dist_x * p_x) + (dist_y * p_y) + (dist_z * p_z);
+
+        // perpendicular = cross(dist, edge1)
+        const float perp_x = (dist_y * edge1.z) - (dist_z * edge1.y);
+        const float perp_y = (dist_z * edge1.x) - (dist_x * edge1.z);
+        const float perp_z = (dist_x * edge1.y) - (dist_y * edge1.x);
+
+        const float v = (d_x * perp_x) + (d_y * perp_y) + (d_z * perp_z);
+
+        const bool inside_front = (det > 0.0f) & (u >= 0.0f) & (u <= det) & (v >= 0.0f) & ((u + v) <= det);
+        const bool inside_back  = (det < 0.0f) & (u <= 0.0f) & (u >= det) & (v <= 0.0f) & ((u + v) >= det);
+
+        const float inv_det = 1.0f / det;
+        const float distance = ((edge2.x * perp_x) + (edge2.y * perp_y) + (edge2.z * perp_z)) * inv_det;
+
+        const bool hit = (inside_front | inside_back) & (packet.min_t[i] < distance) & (distance < hits.t[i]);
+        hits.t[i] = hit ? distance : hits.t[i];
+        hits.object[i] = hit ? object : hits.object[i];
+        hits.face[i] = hit ? face_idx : hits.face[i];
+    }
+}
+
+// Front-to-back walk shared by the whole packet. A node is entered if any
+// lane hits it before that lane's closest hit, so divergent rays still get
+// correct results, just with less culling.
+template<int N, typename TestPrimFunc>
+static auto traverse_bvh_closest_packet(const Bvh& bvh, const RayPacket<N>& packet,
+                                        const PacketHits<N>& hits, TestPrimFunc&& test_prim) -> void
+{
+    if (bvh.is_empty())
+    {
+        return;
+    }
+
+    const auto& nodes = bvh.nodes;
+
+    struct StackEntry final
+    {
+        std::uint32_t node;
+        float t_enter;
+    };
+
+    std::array<StackEntry, Bvh::kMaxDepth> stack;
+    int stack_size = 0;
+
+    const float root_t = intersect_packet_aabb(nodes[0].bounds, packet, hits);
+    if (root_t != kInfinity)
+    {
+        stack[stack_size++] = { 0, root_t };
+    }
+
+    while (stack_size > 0)
+    {
+        const StackEntry entry = stack[--stack_size];
+
+        // Skip if every lane already has a hit closer than this node.
+        if (entry.t_enter >= *std::max_element(hits.t.begin(), hits.t.end()))
+        {
+            continue;
+        }
+
+        const Bvh::Node& node = nodes[entry.node];
+
+        if (node.is_leaf())
+        {
+            for (std::uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                test_prim(bvh.prim_indices[i]);
+            }
+            continue;
+        }
+
+        StackEntry near = { node.first, intersect_packet_aabb(nodes[node.first].bounds, packet, hits) };
+        StackEntry far = { node.first + 1, intersect_packet_aabb(nodes[node.first + 1].bounds, packet, hits) };
+
+        if (far.t_enter < near.t_enter)
+        {
+            std::swap(near, far);
+        }
+
+        // Push the far child first so the near one is visited next.
+        if (far.t_enter != kInfinity)
+        {
+            stack[stack_size++] = far;
+        }
+        if (near.t_enter != kInfinity)
+        {
+            stack[stack_size++] = near;
+        }
+    }
 }
 
-// Check if ray is obstructed by any of the scene objects, to decide if a point is in shadow.
-static auto is_obstructed(const Ray& ray, const Scene& scene) -> bool
+// Packet version of closest_intersection(). Updates `hits` in place; lanes
+// left with object=kNoObject missed everything.
+template<int N>
+static auto closest_intersection_packet(const RayPacket<N>& packet, const Scene& scene, PacketHits<N>& hits) -> void
 {
-    if (is_obstructed_by_sphere(ray, scene.spheres))
-    {
-        return true;
-    }
-    
-    if (is_obstructed_by_mesh(ray, scene.meshes))
+    assert(scene.bvh != nullptr);
+    const SceneBvh& scene_bvh = *scene.bvh;
+
+    traverse_bvh_closest_packet(scene_bvh.bvh, packet, hits, [&](const std::uint32_t object)
     {
-        return true;
-    }
-    
-    return false; // Not obstructed.
+        if (object < scene_bvh.num_spheres)
+        {
+            intersect_packet_sphere(packet, scene.spheres[object], object, hits);
+            return;
+        }
+
+        const Mesh& mesh = scene.meshes[object - scene_bvh.num_spheres];
+        mesh.visit_faces([&](const auto faces)
+        {
+            auto test_face = [&](const std::uint32_t face_idx)
+            {
+                intersect_packet_face(packet, mesh, faces, face_idx, object, hits);
+            };
+
+            if (mesh.bvh.is_empty())
+            {
+                for (std::uint32_t face_idx = 0; face_idx < faces.size(); ++face_idx)
+                {
+                    test_face(face_idx);
+                }
+            }
+            else
+            {
+                traverse_bvh_closest_packet(mesh.bvh, packet, hits, test_face);
+            }
+        });
+    });
 }
 
 // ========================================================
@@ -359,7 +888,7 @@ struct ComputedLighting final
     Color color{};
 };
 
-static auto compute_lighting(const RaytraceParams& rt_params, const Scene& scene,
+static auto compute_lighting(const RaytraceParams& rt_params, const Scene& scene, ShadowCache& shadow_cache,
                              const Point3 point, const Vec3 normal, const Vec3 view,
                              const float specular) -> ComputedLighting
 {
@@ -370,8 +899,10 @@ static auto compute_lighting(const RaytraceParams& rt_params, const Scene& scene
     const float length_n = length(normal);
     const float length_v = length(view);
 
-    for (const Light& light : scene.lights)
+    for (std::size_t light_idx = 0; light_idx < scene.lights.size(); ++light_idx)
     {
+        const Light& light = scene.lights[light_idx];
+
         if (light.type == Light::Type::kAmbient)
         {
             sum_intensity += light.intensity;
@@ -410,7 +941,7 @@ static auto compute_lighting(const RaytraceParams& rt_params, const Scene& scene
                 .refractive_index = 0.0f // Not used for shadows.
             };
 
-            if (is_obstructed(shadow_ray, scene))
+            if (is_obstructed(shadow_ray, scene, shadow_cache.last_occluder[light_idx]))
             {
                 continue;
             }
@@ -442,9 +973,10 @@ static auto compute_lighting(const RaytraceParams& rt_params, const Scene& scene
     // Average of all light colors.
     sum_color /= static_cast<float>(num_lights_computed);
 
+    // NOTE: Specular highlights can take the intensity above 1. It is left unclamped
+    // since the HDR target keeps the full range until the final resolve.
     return {
-        // NOTE: Must clamp intensity because specular highlights might go above 1.
-        .intensity = std::clamp(sum_intensity, 0.0f, 1.0f),
+        .intensity = sum_intensity,
         .color = sum_color
     };
 }
@@ -453,27 +985,24 @@ static auto compute_lighting(const RaytraceParams& rt_params, const Scene& scene
 // Raytracing loop:
 // ========================================================
 
-// Traces a ray against the set of objects in the scene and returns a pixel color.
-static auto trace_ray(const RaytraceParams& rt_params, const Scene& scene,
-                      const Ray& ray, const int max_recursion_depth) -> Color
-{
-    const auto intersection_result = closest_intersection(ray, scene);
-    if (!intersection_result)
-    {
-        // No hit for this ray; return background color.
-        return rt_params.background_color;
-    }
+static auto trace_ray(const RaytraceParams& rt_params, const Scene& scene, ShadowCache& shadow_cache,
+                      const Ray& ray, const int max_recursion_depth) -> Color;
 
-    const Material& material = intersection_result->material;
-    const Point3 point = intersection_result->point;
-    const Vec3 normal = intersection_result->normal;
+// Computes the color seen along `ray` at a known surface hit, recursing for reflection and refraction.
+static auto shade_intersection(const RaytraceParams& rt_params, const Scene& scene, ShadowCache& shadow_cache,
+                               const Ray& ray, const ClosestIntersection& intersection,
+                               const int max_recursion_depth) -> Color
+{
+    const Material& material = intersection.material;
+    const Point3 point = intersection.point;
+    const Vec3 normal = intersection.normal;
     const Vec3 view = -ray.direction;
 
     const auto [light_intensity, light_color] =
-        compute_lighting(rt_params, scene, point, normal, view, material.specular);
+        compute_lighting(rt_params, scene, shadow_cache, point, normal, view, material.specular);
 
-    assert(is_normalized(light_intensity)); // Light intensity is normalised.
-    assert(is_normalized(light_color)); // Light color should also be in the 0-1 range.
+    assert(light_intensity >= 0.0f); // Light intensity may go above 1 due to specular highlights.
+    assert(is_normalized(light_color)); // Light color should be in the 0-1 range.
 
     const Color surface_color = material.color * light_color * light_intensity;
 
@@ -513,7 +1042,7 @@ static auto trace_ray(const RaytraceParams& rt_params, const Scene& scene,
             .refractive_index = material.refractive_index
         };
 
-        const Color reflected_color = trace_ray(rt_params, scene,
+        const Color reflected_color = trace_ray(rt_params, scene, shadow_cache,
                                                 reflected_ray, max_recursion_depth - 1);
 
         final_color = (reflected_color * material.reflectiveness) +
@@ -532,7 +1061,7 @@ static auto trace_ray(const RaytraceParams& rt_params, const Scene& scene,
             .refractive_index = ray.refractive_index
         };
 
-        const Color refracted_color = trace_ray(rt_params, scene,
+        const Color refracted_color = trace_ray(rt_params, scene, shadow_cache,
                                                 refracted_ray, max_recursion_depth - 1);
 
         const Ray reflected_ray = {
@@ -543,7 +1072,7 @@ static auto trace_ray(const RaytraceParams& rt_params, const Scene& scene,
             .refractive_index = ray.refractive_index
         };
 
-        const Color reflected_color = trace_ray(rt_params, scene,
+        const Color reflected_color = trace_ray(rt_params, scene, shadow_cache,
                                                 reflected_ray, max_recursion_depth - 1);
 
         const float r = fresnel_reflection(ray.direction, -normal,
@@ -557,211 +1086,466 @@ static auto trace_ray(const RaytraceParams& rt_params, const Scene& scene,
     // Transparency is computed by the raytracer, so alpha can be fixed to 1.
     final_color.a = 1.0f;
 
-    assert(is_normalized(final_color));
     return final_color;
 }
 
-static auto trace_ray_at_point(Canvas& canvas, const RaytraceParams& rt_params,
-                               const Scene& scene, const Point2 point) -> void
+// Traces a ray against the set of objects in the scene and returns a pixel color.
+static auto trace_ray(const RaytraceParams& rt_params, const Scene& scene, ShadowCache& shadow_cache,
+                      const Ray& ray, const int max_recursion_depth) -> Color
+{
+    const auto intersection_result = closest_intersection(ray, scene);
+    if (!intersection_result)
+    {
+        // No hit for this ray; return background color.
+        return rt_params.background_color;
+    }
+
+    return shade_intersection(rt_params, scene, shadow_cache, ray, *intersection_result, max_recursion_depth);
+}
+
+// Ray from the camera through canvas position (x, y), which may lie between pixel centers.
+static auto make_primary_ray(const HdrCanvas& canvas, const RaytraceParams& rt_params, const float x, const float y) -> Ray
 {
-    Vec3 camera_direction = canvas.to_viewport(point);
+    Vec3 camera_direction = canvas.to_viewport(x, y);
     camera_direction = rt_params.camera.rotation * camera_direction;
 
-    const Ray ray = {
+    return {
         .origin = rt_params.camera.position,
         .direction = camera_direction,
         .min_t = 1.0f,
         .max_t = kInfinity,
         .refractive_index = 1.0f // Refraction index of air - fully transparent medium.
     };
+}
 
-    const Color color = trace_ray(rt_params, scene, ray,
+static auto make_primary_ray(const HdrCanvas& canvas, const RaytraceParams& rt_params, const Point2 point) -> Ray
+{
+    return make_primary_ray(canvas, rt_params, static_cast<float>(point.x), static_cast<float>(point.y));
+}
+
+static auto trace_ray_at_point(HdrCanvas& canvas, const RaytraceParams& rt_params,
+                               const Scene& scene, ShadowCache& shadow_cache, const Point2 point) -> void
+{
+    const Ray ray = make_primary_ray(canvas, rt_params, point);
+
+    const Color color = trace_ray(rt_params, scene, shadow_cache, ray,
                                   rt_params.max_recursion_depth);
 
     canvas.draw_pixel(point, color);
 }
 
-// One pass single threaded raytrace.
-static auto raytrace_single_thread(Canvas& canvas, const RaytraceParams& rt_params, const Scene& scene) -> void
+// Max per-channel difference between neighbor pixels above which adaptive supersampling kicks in.
+constexpr float kAdaptiveColorThreshold = 0.1f;
+
+// Integer hash mapped to [0,1). Jitter comes from the pixel and sample indices
+// rather than a random generator, so images don't depend on thread scheduling.
+static auto hash_to_unit_float(std::uint32_t x) -> float
 {
-    const auto half_width = canvas.width() / 2;
-    const auto half_height = canvas.height() / 2;
-    
-    for (auto x = -half_width; x < half_width; ++x)
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+}
+
+// Average of NxN rays, one jittered ray in each cell of a regular grid over the pixel.
+static auto trace_supersampled_pixel(const HdrCanvas& canvas, const RaytraceParams& rt_params, const Scene& scene,
+                                     ShadowCache& shadow_cache, const Point2 point) -> Color
+{
+    const int n = rt_params.supersampling;
+    const float cell_size = 1.0f / static_cast<float>(n);
+
+    Color sum_color{};
+
+    for (int cell_y = 0; cell_y < n; ++cell_y)
     {
-        for (auto y = -half_height; y < half_height; ++y)
+        for (int cell_x = 0; cell_x < n; ++cell_x)
         {
-            trace_ray_at_point(canvas, rt_params, scene, { x, y });
+            const std::uint32_t seed = (static_cast<std::uint32_t>(point.x) * 73856093u) ^
+                                       (static_cast<std::uint32_t>(point.y) * 19349663u) ^
+                                       (static_cast<std::uint32_t>((cell_y * n) + cell_x) * 83492791u);
+
+            // The pixel spans half a unit on each side of the position of its single ray.
+            const float x = static_cast<float>(point.x) - 0.5f + ((static_cast<float>(cell_x) + hash_to_unit_float(seed)) * cell_size);
+            const float y = static_cast<float>(point.y) - 0.5f + ((static_cast<float>(cell_y) + hash_to_unit_float(seed + 1)) * cell_size);
+
+            const Ray ray = make_primary_ray(canvas, rt_params, x, y);
+            sum_color += trace_ray(rt_params, scene, shadow_cache, ray, rt_params.max_recursion_depth);
         }
     }
+
+    return sum_color / static_cast<float>(n * n);
 }
 
-// 4 raytracing threads, canvas is split into 4 sections, each thread handles one section.
-static auto raytrace_4_threads(Canvas& canvas, const RaytraceParams& rt_params, const Scene& scene) -> void
+// Color and object of the single ray through a pixel.
+struct PixelSample final
 {
-    const auto half_width = canvas.width() / 2;
-    const auto half_height = canvas.height() / 2;
-    
-    // 3 threads worker + the calling thread.
-    std::array<std::future<void>, 3> threads{};
+    Color color{};
+    std::uint32_t object{ kNoObject };
+};
+
+static auto trace_pixel_sample(const HdrCanvas& canvas, const RaytraceParams& rt_params, const Scene& scene,
+                               ShadowCache& shadow_cache, const Point2 point) -> PixelSample
+{
+    const Ray ray = make_primary_ray(canvas, rt_params, point);
+
+    const auto intersection_result = closest_intersection(ray, scene);
+    if (!intersection_result)
+    {
+        return { .color = rt_params.background_color, .object = kNoObject };
+    }
+
+    return {
+        .color = shade_intersection(rt_params, scene, shadow_cache, ray, *intersection_result, rt_params.max_recursion_depth),
+        .object = intersection_result->object
+    };
+}
+
+static auto is_similar_sample(const PixelSample& lhs, const PixelSample& rhs) -> bool
+{
+    return lhs.object == rhs.object &&
+           std::fabs(lhs.color.r - rhs.color.r) <= kAdaptiveColorThreshold &&
+           std::fabs(lhs.color.g - rhs.color.g) <= kAdaptiveColorThreshold &&
+           std::fabs(lhs.color.b - rhs.color.b) <= kAdaptiveColorThreshold;
+}
+
+// Range of canvas pixels: x = [x_start, x_end), y = [y_start, y_end).
+struct PixelRect final
+{
+    int x_start{};
+    int y_start{};
+    int x_end{};
+    int y_end{};
+};
 
-    // Botton left:
-    threads[0] = std::async(std::launch::async, [&]() {
-        for (auto x = -half_width; x < 0; ++x)
+// Traces the primary rays of a small block of pixels as one packet, then shades every
+// hit with the scalar path. Pixels of the block that fall outside `rect` are masked off.
+template<int N>
+static auto trace_packet_at_block(HdrCanvas& canvas, const RaytraceParams& rt_params, const Scene& scene,
+                                  ShadowCache& shadow_cache, const PixelRect& rect, const Point2 block_start) -> void
+{
+    constexpr int kBlockWidth = (N == 4) ? 2 : 4;
+    static_assert(N % kBlockWidth == 0);
+
+    std::array<Ray, N> rays{};
+    std::array<bool, N> active{};
+    PacketHits<N> hits{};
+
+    for (int i = 0; i < N; ++i)
+    {
+        const Point2 point = { block_start.x + (i % kBlockWidth), block_start.y + (i / kBlockWidth) };
+        active[i] = (point.x < rect.x_end && point.y < rect.y_end);
+
+        // Inactive lanes still get a valid ray so the math stays well defined.
+        rays[i] = make_primary_ray(canvas, rt_params, active[i] ? point : block_start);
+
+        hits.t[i] = active[i] ? rays[i].max_t : -kInfinity;
+        hits.object[i] = kNoObject;
+    }
+
+    closest_intersection_packet(make_ray_packet<N>(rays), scene, hits);
+
+    for (int i = 0; i < N; ++i)
+    {
+        if (!active[i])
         {
-            for (auto y = -half_height; y < 0; ++y)
-            {
-                trace_ray_at_point(canvas, rt_params, scene, { x, y });
-            }
+            continue;
         }
-    });
 
-    // Botton right:
-    threads[1] = std::async(std::launch::async, [&]() {
-        for (auto x = 0; x < half_width; ++x)
+        const Point2 point = { block_start.x + (i % kBlockWidth), block_start.y + (i / kBlockWidth) };
+        Color color = rt_params.background_color;
+
+        if (hits.object[i] != kNoObject)
         {
-            for (auto y = -half_height; y < 0; ++y)
-            {
-                trace_ray_at_point(canvas, rt_params, scene, { x, y });
-            }
+            const bool is_mesh = (hits.object[i] >= scene.bvh->num_spheres);
+            const std::uint32_t face_idx = is_mesh ? hits.face[i] : kNoFace;
+
+            const ClosestIntersection intersection = make_intersection(rays[i], scene, hits.t[i], hits.object[i], face_idx);
+            color = shade_intersection(rt_params, scene, shadow_cache, rays[i], intersection, rt_params.max_recursion_depth);
         }
-    });
 
-    // Top left:
-    threads[2] = std::async(std::launch::async, [&]() {
-        for (auto x = -half_width; x < 0; ++x)
+        canvas.draw_pixel(point, color);
+    }
+}
+
+template<int N>
+static auto raytrace_rect_packets(HdrCanvas& canvas, const RaytraceParams& rt_params, const Scene& scene,
+                                  ShadowCache& shadow_cache, const PixelRect& rect) -> void
+{
+    constexpr int kBlockWidth = (N == 4) ? 2 : 4;
+    constexpr int kBlockHeight = N / kBlockWidth;
+
+    for (auto y = rect.y_start; y < rect.y_end; y += kBlockHeight)
+    {
+        for (auto x = rect.x_start; x < rect.x_end; x += kBlockWidth)
         {
-            for (auto y = 0; y < half_height; ++y)
-            {
-                trace_ray_at_point(canvas, rt_params, scene, { x, y });
-            }
+            trace_packet_at_block<N>(canvas, rt_params, scene, shadow_cache, rect, { x, y });
         }
-    });
+    }
+}
+
+static auto raytrace_rect(HdrCanvas& canvas, const RaytraceParams& rt_params,
+                          const Scene& scene, const PixelRect& rect) -> void
+{
+    ShadowCache shadow_cache{ scene };
 
-    // Top right:
-    // (do it on main thread while waiting for other threads to finish)
-    for (auto x = 0; x < half_width; ++x)
+    if (rt_params.supersampling > 1)
     {
-        for (auto y = 0; y < half_height; ++y)
+        for (auto x = rect.x_start; x < rect.x_end; ++x)
         {
-            trace_ray_at_point(canvas, rt_params, scene, { x, y });
+            for (auto y = rect.y_start; y < rect.y_end; ++y)
+            {
+                canvas.draw_pixel({ x, y }, trace_supersampled_pixel(canvas, rt_params, scene, shadow_cache, { x, y }));
+            }
         }
+        return;
     }
 
-    // Synchronize threads.
-    for (auto& t : threads)
+    switch (rt_params.ray_packets)
     {
-        t.wait();
+    case RayPackets::kDisabled:
+        for (auto x = rect.x_start; x < rect.x_end; ++x)
+        {
+            for (auto y = rect.y_start; y < rect.y_end; ++y)
+            {
+                trace_ray_at_point(canvas, rt_params, scene, shadow_cache, { x, y });
+            }
+        }
+        break;
+
+    case RayPackets::k2x2:
+        raytrace_rect_packets<4>(canvas, rt_params, scene, shadow_cache, rect);
+        break;
+
+    case RayPackets::k4x2:
+        raytrace_rect_packets<8>(canvas, rt_params, scene, shadow_cache, rect);
+        break;
+
+    case RayPackets::k4x4:
+        raytrace_rect_packets<16>(canvas, rt_params, scene, shadow_cache, rect);
+        break;
     }
 }
 
-// 8 raytracing threads, canvas is split into 8 sections, each thread handles one section.
-static auto raytrace_8_threads(Canvas& canvas, const RaytraceParams& rt_params, const Scene& scene) -> void
+// One pass single threaded raytrace.
+static auto raytrace_single_thread(HdrCanvas& canvas, const RaytraceParams& rt_params, const Scene& scene) -> void
 {
     const auto half_width = canvas.width() / 2;
     const auto half_height = canvas.height() / 2;
-    const auto quarter_width = canvas.width() / 4;
 
-    // 7 threads worker + the calling thread.
-    std::array<std::future<void>, 7> threads{};
+    raytrace_rect(canvas, rt_params, scene, { -half_width, -half_height, half_width, half_height });
+}
 
-    // Botton left 1:
-    threads[0] = std::async(std::launch::async, [&]() {
-        for (auto x = -half_width; x < -quarter_width; ++x)
-        {
-            for (auto y = -half_height; y < 0; ++y)
-            {
-                trace_ray_at_point(canvas, rt_params, scene, { x, y });
-            }
-        }
-    });
+// Canvas split into small square tiles, which are the unit of work handed out to threads.
+struct TileGrid final
+{
+    static constexpr int kTileSize = 16;
+
+    int half_width{};
+    int half_height{};
+    int tiles_x{};
+    int tiles_y{};
+
+    explicit TileGrid(const HdrCanvas& canvas)
+        : half_width{ canvas.width() / 2 }
+        , half_height{ canvas.height() / 2 }
+        , tiles_x{ ((half_width * 2) + kTileSize - 1) / kTileSize }
+        , tiles_y{ ((half_height * 2) + kTileSize - 1) / kTileSize }
+    {
+    }
+
+    auto tile_count() const -> std::uint32_t
+    {
+        return static_cast<std::uint32_t>(tiles_x * tiles_y);
+    }
+
+    auto tile_rect(const std::uint32_t tile_idx) const -> PixelRect
+    {
+        const int x_start = -half_width + ((static_cast<int>(tile_idx) % tiles_x) * kTileSize);
+        const int y_start = -half_height + ((static_cast<int>(tile_idx) / tiles_x) * kTileSize);
+
+        return {
+            .x_start = x_start,
+            .y_start = y_start,
+            .x_end = std::min(x_start + kTileSize, half_width),
+            .y_end = std::min(y_start + kTileSize, half_height)
+        };
+    }
+};
+
+// Runs `func(thread_pool)` on the caller's persistent pool or, if there
+// isn't one, on a one-off pool sized from the Threading mode.
+template<typename Func>
+static auto with_thread_pool(const RaytraceParams& rt_params, Func&& func) -> void
+{
+    // Caller provided a persistent pool; its size wins over the Threading mode.
+    if (rt_params.thread_pool != nullptr)
+    {
+        func(*rt_params.thread_pool);
+        return;
+    }
+
+    std::uint32_t num_threads = rt_params.num_threads;
+    if (rt_params.threading == Threading::k4Threads)
+    {
+        num_threads = 4;
+    }
+    else if (rt_params.threading == Threading::k8Threads)
+    {
+        num_threads = 8;
+    }
 
-    // Botton left 2:
-    threads[1] = std::async(std::launch::async, [&]() {
-        for (auto x = -quarter_width; x < 0; ++x)
+    // One-off pool, torn down at the end of the frame.
+    ThreadPool thread_pool{ num_threads };
+    func(thread_pool);
+}
+
+// Calls `func(rect)` for every tile of the canvas. Single threaded, tiles run in order on
+// the calling thread. Otherwise they are handed out to the threads of a work-stealing
+// pool, so expensive regions (e.g. refractive objects) don't stall a single thread.
+template<typename Func>
+static auto for_each_tile(const HdrCanvas& canvas, const RaytraceParams& rt_params, Func&& func) -> void
+{
+    const TileGrid tile_grid{ canvas };
+
+    if (rt_params.threading == Threading::kSingleThread)
+    {
+        for (std::uint32_t tile_idx = 0; tile_idx < tile_grid.tile_count(); ++tile_idx)
         {
-            for (auto y = -half_height; y < 0; ++y)
-            {
-                trace_ray_at_point(canvas, rt_params, scene, { x, y });
-            }
+            func(tile_grid.tile_rect(tile_idx));
         }
+        return;
+    }
+
+    with_thread_pool(rt_params, [&](ThreadPool& thread_pool) {
+        thread_pool.parallel_for(tile_grid.tile_count(), [&](const std::uint32_t tile_idx, std::uint32_t) {
+            func(tile_grid.tile_rect(tile_idx));
+        });
     });
+}
 
-    // Botton right 1:
-    threads[2] = std::async(std::launch::async, [&]() {
-        for (auto x = 0; x < quarter_width; ++x)
-        {
-            for (auto y = -half_height; y < 0; ++y)
-            {
-                trace_ray_at_point(canvas, rt_params, scene, { x, y });
-            }
-        }
+static auto raytrace_multi_thread(HdrCanvas& canvas, const RaytraceParams& rt_params, const Scene& scene) -> void
+{
+    for_each_tile(canvas, rt_params, [&](const PixelRect& rect) {
+        raytrace_rect(canvas, rt_params, scene, rect);
     });
-    
-    // Botton right 2:
-    threads[3] = std::async(std::launch::async, [&]() {
-        for (auto x = quarter_width; x < half_width; ++x)
+}
+
+// Two passes over the canvas: first one ray per pixel, keeping its color and the object it hit,
+// then NxN supersampling only for pixels that differ from one of their 4 neighbors.
+// Flat regions cost a single ray per pixel while edges get the full NxN.
+static auto raytrace_adaptive_supersampled(HdrCanvas& canvas, const RaytraceParams& rt_params, const Scene& scene) -> void
+{
+    const int half_width = canvas.width() / 2;
+    const int half_height = canvas.height() / 2;
+    const int width = half_width * 2;
+    const int height = half_height * 2;
+
+    std::vector<PixelSample> samples(static_cast<std::size_t>(width * height));
+
+    auto sample_at = [&](const int x, const int y) -> PixelSample&
+    {
+        return samples[((y + half_height) * width) + (x + half_width)];
+    };
+
+    for_each_tile(canvas, rt_params, [&](const PixelRect& rect) {
+        ShadowCache shadow_cache{ scene };
+
+        for (auto x = rect.x_start; x < rect.x_end; ++x)
         {
-            for (auto y = -half_height; y < 0; ++y)
+            for (auto y = rect.y_start; y < rect.y_end; ++y)
             {
-                trace_ray_at_point(canvas, rt_params, scene, { x, y });
+                sample_at(x, y) = trace_pixel_sample(canvas, rt_params, scene, shadow_cache, { x, y });
             }
         }
     });
 
-    // Top left 1:
-    threads[4] = std::async(std::launch::async, [&]() {
-        for (auto x = -half_width; x < -quarter_width; ++x)
+    for_each_tile(canvas, rt_params, [&](const PixelRect& rect) {
+        ShadowCache shadow_cache{ scene };
+
+        for (auto x = rect.x_start; x < rect.x_end; ++x)
         {
-            for (auto y = 0; y < half_height; ++y)
+            for (auto y = rect.y_start; y < rect.y_end; ++y)
             {
-                trace_ray_at_point(canvas, rt_params, scene, { x, y });
+                const PixelSample& sample = sample_at(x, y);
+
+                const bool is_edge =
+                    (x > -half_width      && !is_similar_sample(sample, sample_at(x - 1, y))) ||
+                    (x < half_width - 1   && !is_similar_sample(sample, sample_at(x + 1, y))) ||
+                    (y > -half_height     && !is_similar_sample(sample, sample_at(x, y - 1))) ||
+                    (y < half_height - 1  && !is_similar_sample(sample, sample_at(x, y + 1)));
+
+                canvas.draw_pixel({ x, y }, is_edge ?
+                                  trace_supersampled_pixel(canvas, rt_params, scene, shadow_cache, { x, y }) :
+                                  sample.color);
             }
         }
     });
+}
+
+// ========================================================
+// Progressive raytracing:
+// ========================================================
 
-    // Top left 2:
-    threads[5] = std::async(std::launch::async, [&]() {
-        for (auto x = -quarter_width; x < 0; ++x)
+// Traces the pixels of a tile that are new in the pass with the given block size. Each one
+// fills the block_size x block_size block it stands for until a finer pass refines it.
+static auto raytrace_rect_progressive(HdrCanvas& canvas, const RaytraceParams& rt_params, const Scene& scene,
+                                      const PixelRect& rect, const int block_size) -> void
+{
+    ShadowCache shadow_cache{ scene };
+    const bool is_first_pass = (block_size == ProgressiveRaytrace::kInitialBlockSize);
+
+    for (auto y = rect.y_start; y < rect.y_end; y += block_size)
+    {
+        for (auto x = rect.x_start; x < rect.x_end; x += block_size)
         {
-            for (auto y = 0; y < half_height; ++y)
+            // Pixels on the grid of the previous, twice as coarse, pass were traced already.
+            // Tiles are a multiple of the initial block size, so the grid is aligned to the tile.
+            if (!is_first_pass &&
+                ((x - rect.x_start) % (block_size * 2)) == 0 &&
+                ((y - rect.y_start) % (block_size * 2)) == 0)
             {
-                trace_ray_at_point(canvas, rt_params, scene, { x, y });
+                continue;
             }
-        }
-    });
 
-    // Top right 1:
-    threads[6] = std::async(std::launch::async, [&]() {
-        for (auto x = 0; x < quarter_width; ++x)
-        {
-            for (auto y = 0; y < half_height; ++y)
+            const Ray ray = make_primary_ray(canvas, rt_params, { x, y });
+            const Color color = trace_ray(rt_params, scene, shadow_cache, ray, rt_params.max_recursion_depth);
+
+            for (auto block_y = y; block_y < std::min(y + block_size, rect.y_end); ++block_y)
             {
-                trace_ray_at_point(canvas, rt_params, scene, { x, y });
+                for (auto block_x = x; block_x < std::min(x + block_size, rect.x_end); ++block_x)
+                {
+                    canvas.draw_pixel({ block_x, block_y }, color);
+                }
             }
         }
-    });
+    }
+}
+
+static_assert(TileGrid::kTileSize % ProgressiveRaytrace::kInitialBlockSize == 0);
 
-    // Top right 2:
-    // (do it on main thread while waiting for other threads to finish)
-    for (auto x = quarter_width; x < half_width; ++x)
+// Public API.
+auto raytrace(HdrCanvas& canvas, const RaytraceParams& rt_params, const Scene& scene) -> void
+{
+    // No prebuilt acceleration structure; make one just for this frame.
+    if (scene.bvh == nullptr)
     {
-        for (auto y = 0; y < half_height; ++y)
-        {
-            trace_ray_at_point(canvas, rt_params, scene, { x, y });
-        }
+        const SceneBvh scene_bvh = build_scene_bvh(scene);
+
+        Scene accelerated_scene = scene;
+        accelerated_scene.bvh = &scene_bvh;
+
+        raytrace(canvas, rt_params, accelerated_scene);
+        return;
     }
 
-    // Synchronize threads.
-    for (auto& t : threads)
+    if (rt_params.supersampling > 1 && rt_params.adaptive_supersampling)
     {
-        t.wait();
+        raytrace_adaptive_supersampled(canvas, rt_params, scene);
+        return;
     }
-}
 
-// Public API.
-auto raytrace(Canvas& canvas, const RaytraceParams& rt_params, const Scene& scene) -> void
-{
     switch (rt_params.threading)
     {
     case Threading::kSingleThread:
@@ -769,13 +1553,81 @@ auto raytrace(Canvas& canvas, const RaytraceParams& rt_params, const Scene& scen
         break;
         
     case Threading::k4Threads:
-        raytrace_4_threads(canvas, rt_params, scene);
-        break;
-        
     case Threading::k8Threads:
-        raytrace_8_threads(canvas, rt_params, scene);
+    case Threading::kAuto:
+        raytrace_multi_thread(canvas, rt_params, scene);
         break;
     }
 }
 
+auto raytrace(Canvas& canvas, const RaytraceParams& rt_params, const Scene& scene) -> void
+{
+    HdrCanvas hdr_canvas{ canvas.dimensions() };
+    raytrace(hdr_canvas, rt_params, scene);
+    hdr_canvas.resolve(canvas, ToneMapping::kClamp);
+}
+
+auto raytrace_progressive(HdrCanvas& canvas, const RaytraceParams& rt_params, const Scene& scene,
+                          ProgressiveRaytrace& progress, const std::chrono::milliseconds time_budget) -> bool
+{
+    if (progress.is_complete())
+    {
+        return true;
+    }
+
+    // No prebuilt acceleration structure; make one just for this call.
+    if (scene.bvh == nullptr)
+    {
+        const SceneBvh scene_bvh = build_scene_bvh(scene);
+
+        Scene accelerated_scene = scene;
+        accelerated_scene.bvh = &scene_bvh;
+
+        return raytrace_progressive(canvas, rt_params, accelerated_scene, progress, time_budget);
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + time_budget;
+    const TileGrid tile_grid{ canvas };
+
+    // Renders batches of tiles, moving on to the next pass whenever one completes,
+    // until out of time. At least one batch always runs so every call makes progress.
+    auto run_batches = [&](const std::uint32_t batch_size, auto&& trace_tiles)
+    {
+        do
+        {
+            const std::uint32_t count = std::min(batch_size, tile_grid.tile_count() - progress.next_tile);
+            trace_tiles(progress.next_tile, count);
+            progress.next_tile += count;
+
+            if (progress.next_tile == tile_grid.tile_count())
+            {
+                progress.block_size /= 2; // 1 -> 0 once the full resolution pass is done.
+                progress.next_tile = 0;
+            }
+        } while (!progress.is_complete() && std::chrono::steady_clock::now() < deadline);
+    };
+
+    if (rt_params.threading == Threading::kSingleThread)
+    {
+        run_batches(1, [&](const std::uint32_t first_tile, std::uint32_t) {
+            raytrace_rect_progressive(canvas, rt_params, scene, tile_grid.tile_rect(first_tile), progress.block_size);
+        });
+    }
+    else
+    {
+        assert(rt_params.thread_pool != nullptr && "Progressive raytrace needs a persistent thread pool!");
+
+        with_thread_pool(rt_params, [&](ThreadPool& thread_pool) {
+            // A few tiles per thread between deadline checks keeps every thread busy.
+            run_batches(thread_pool.num_threads() * 4, [&](const std::uint32_t first_tile, const std::uint32_t count) {
+                thread_pool.parallel_for(count, [&](const std::uint32_t i, std::uint32_t) {
+                    raytrace_rect_progressive(canvas, rt_params, scene, tile_grid.tile_rect(first_tile + i), progress.block_size);
+                });
+            });
+        });
+    }
+
+    return progress.is_complete();
+}
+
 } // cgfs::raytracer
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "scene.hpp"
-#include "../common/canvas.hpp"
+#include "../common/hdr_canvas.hpp"
+#include "../common/thread_pool.hpp"
+
+#include <chrono>
 
 namespace cgfs::raytracer
 {
@@ -10,7 +13,18 @@ enum class Threading : int
 {
     kSingleThread,
     k4Threads,
-    k8Threads
+    k8Threads,
+    kAuto // Uses RaytraceParams::num_threads.
+};
+
+// Primary rays of neighboring pixels can be traced together as a packet.
+// Secondary rays (shadows, reflections, refraction) always use the per-pixel path.
+enum class RayPackets : int
+{
+    kDisabled, // One ray per pixel.
+    k2x2,      // 4-ray packets.
+    k4x2,      // 8-ray packets.
+    k4x4       // 16-ray packets.
 };
 
 struct RaytraceParams final
@@ -18,6 +32,11 @@ struct RaytraceParams final
     const Camera& camera;
     Color background_color{};
     Threading threading{ Threading::kSingleThread };
+    std::uint32_t num_threads{ 0 }; // Only for Threading::kAuto; 0=one per hardware thread.
+    ThreadPool* thread_pool{ nullptr }; // Optional, reused across frames by multithreaded modes; null=temporary pool per call.
+    RayPackets ray_packets{ RayPackets::kDisabled }; // Ignored when supersampling.
+    int supersampling{ 1 }; // Anti-aliasing with NxN jittered rays per pixel; 1=single ray per pixel.
+    bool adaptive_supersampling{ false }; // Only supersample pixels whose color or object differ from a neighbor's.
     bool specular{ false };
     bool shadows{ false };
     bool reflections{ false };
@@ -25,6 +44,34 @@ struct RaytraceParams final
     int max_recursion_depth{ 0 }; // For reflections & refraction; 0=disables reflections/refraction
 };
 
+// Colors are written to `canvas` unclamped; resolve it to get a displayable image.
+auto raytrace(HdrCanvas& canvas, const RaytraceParams& rt_params, const Scene& scene) -> void;
+
+// Raytraces into a temporary HdrCanvas, then resolves it into `canvas` with ToneMapping::kClamp.
 auto raytrace(Canvas& canvas, const RaytraceParams& rt_params, const Scene& scene) -> void;
 
+// Progress of an image rendered over several raytrace_progressive() calls.
+// Start from a default constructed one and reset() it when the scene or camera changes.
+struct ProgressiveRaytrace final
+{
+    static constexpr int kInitialBlockSize = 8;
+
+    int block_size{ kInitialBlockSize }; // Block side of the current pass; 0=image complete.
+    std::uint32_t next_tile{ 0 };        // Next tile to trace in the current pass.
+
+    auto is_complete() const -> bool { return block_size == 0; }
+    auto reset() -> void { *this = {}; }
+};
+
+// Coarse to fine raytrace for interactive previews. The first pass traces one ray per 8x8
+// block and fills the whole block with it; each following pass halves the block size, reusing
+// the pixels already traced, down to 1x1. Renders for about `time_budget` per call, updating
+// the canvas in place, and returns true once the full resolution image is done.
+// Resolve the canvas after each call to display the partial image.
+// Pass a Scene with a prebuilt bvh to avoid rebuilding it on every call. Always one ray per pixel.
+// Multithreaded modes require a persistent RaytraceParams::thread_pool: a temporary pool per call
+// would spend part of every `time_budget` starting threads.
+auto raytrace_progressive(HdrCanvas& canvas, const RaytraceParams& rt_params, const Scene& scene,
+                          ProgressiveRaytrace& progress, std::chrono::milliseconds time_budget) -> bool;
+
 } // cgfs::raytracer
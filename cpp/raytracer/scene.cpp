@@ -1,95 +1,267 @@
 #include "scene.hpp"
+#include "../common/obj_file.hpp"
+#include "../common/mesh_cache.hpp"
 
+#include <algorithm>
 #include <string>
-#include <fstream>
-#include <sstream>
-#include <iostream>
 
 namespace cgfs::raytracer
 {
 
-auto load_obj_mesh_from_file(Mesh& mesh, const std::string& filename, const float vertex_scale) -> bool
+auto load_obj_mesh_from_file(Mesh& mesh, const std::string& filename, const float vertex_scale, ThreadPool* thread_pool) -> bool
 {
-    std::ifstream file{ filename };
-    if (!file.is_open())
+    ObjFile obj{};
+    if (!load_obj_file(obj, filename, vertex_scale, thread_pool))
     {
-        std::println(stderr, "Error: Could not open file: '{}'", filename);
         return false;
     }
 
-    std::string line{};
-    while (std::getline(file, line))
+    mesh.vertices = std::move(obj.vertices);
+    mesh.normals = std::move(obj.normals);
+    mesh.faces.clear();
+    mesh.large_faces.clear();
+
+    // 16-bit indices when they are enough, 32-bit otherwise.
+    const bool is_large = std::max(mesh.vertices.size(), mesh.normals.size()) > std::size_t{ UINT16_MAX } + 1;
+    const auto import_faces = [&]<typename IndexT>(std::vector<Mesh::BasicFace<IndexT>>& faces) -> bool
     {
-        std::istringstream ss{ line };
-        std::string prefix{};
-        ss >> prefix;
+        faces.reserve(obj.faces.size());
 
-        // Parse vertices (v)
-        if (prefix == "v")
-        {
-            Point3 v = {};
-            ss >> v.x >> v.y >> v.z;
-            mesh.vertices.push_back(v * vertex_scale);
-        }
-        // Parse normals (vn)
-        else if (prefix == "vn")
+        for (const ObjFile::Face& obj_face : obj.faces)
         {
-            Vec3 vn = {};
-            ss >> vn.x >> vn.y >> vn.z;
-            mesh.normals.push_back(vn);
-        }
-        // Parse faces (f)
-        else if (prefix == "f")
-        {
-            Mesh::Face face = {};
-            std::string face_info{};
+            Mesh::BasicFace<IndexT> face = {};
 
-            // Only support triangles (3 vertices per face).
-            for (int count = 0; ss >> face_info; ++count)
+            for (int count = 0; count < 3; ++count)
             {
-                if (count >= 3) [[unlikely]]
+                const ObjFile::Corner& corner = obj_face.corners[count];
+
+                if (corner.normal == ObjFile::kNoIndex) [[unlikely]]
                 {
-                    std::println(stderr, "Non-triangle OBJ model face: `{}`", face_info);
+                    std::println(stderr, "Unsupported OBJ model face format, missing normals: '{}'", filename);
                     return false;
                 }
-                
-                std::string face_vertex{};
-                std::string face_normal{};
 
-                // `f vertex_index//normal_index`
-                if (const auto double_slash = face_info.find("//"); double_slash != std::string::npos)
+                if (corner.vert >= mesh.vertices.size() || corner.normal >= mesh.normals.size()) [[unlikely]]
                 {
-                    face_vertex = face_info.substr(0, double_slash);
-                    face_normal = face_info.substr(double_slash + 2); // +2 skips '//' separator
-                }
-                // `f vertex_index/texture_index/normal_index`
-                else if (const auto single_slash = face_info.find('/'); single_slash != std::string::npos)
-                {
-                    const auto last_slash = face_info.find_last_of('/');
-                    face_vertex = face_info.substr(0, single_slash);
-                    face_normal = face_info.substr(last_slash + 1);
-                }
-                else [[unlikely]]
-                {
-                    std::println(stderr, "Unsupported OBJ model face format: `{}`", face_info);
+                    std::println(stderr, "Out of range OBJ model face index: '{}'", filename);
                     return false;
                 }
 
-                const int vertex_index = std::stoi(face_vertex) - 1; // Convert from 1-based to 0-based.
-                assert(vertex_index >= 0 && vertex_index <= UINT16_MAX); // 16bit indices.
-
-                const int normal_index = std::stoi(face_normal) - 1;
-                assert(normal_index >= 0 && normal_index <= UINT16_MAX);
-
-                face.verts[count] = static_cast<std::uint16_t>(vertex_index);
-                face.normal = static_cast<std::uint16_t>(normal_index);
+                face.verts[count] = static_cast<IndexT>(corner.vert);
+                face.normal = static_cast<IndexT>(corner.normal);
             }
 
-            mesh.faces.push_back(face);
+            faces.push_back(face);
         }
+
+        return true;
+    };
+
+    if (!(is_large ? import_faces(mesh.large_faces) : import_faces(mesh.faces)))
+    {
+        return false;
+    }
+
+    build_mesh_bvh(mesh);
+    return true;
+}
+
+// ========================================================
+// Mesh cache:
+// ========================================================
+
+constexpr std::uint32_t kMeshCacheLayout = 0x52415954; // "RAYT"
+
+enum MeshCacheChunkId : std::uint32_t
+{
+    kCacheVertices,
+    kCacheNormals,
+    kCacheFaces16,
+    kCacheFaces32,
+    kCacheBvhNodes,
+    kCacheBvhPrimIndices,
+};
+
+static auto read_mesh_cache(Mesh& mesh, const std::string& cache_filename, const MeshCacheKey& key) -> bool
+{
+    const MeshCacheReader cache{ cache_filename, key };
+
+    mesh.faces.clear();
+    mesh.large_faces.clear();
+
+    return cache.is_valid() &&
+           cache.read(kCacheVertices, mesh.vertices) &&
+           cache.read(kCacheNormals, mesh.normals) &&
+           (cache.read(kCacheFaces16, mesh.faces) || cache.read(kCacheFaces32, mesh.large_faces)) &&
+           cache.read(kCacheBvhNodes, mesh.bvh.nodes) &&
+           cache.read(kCacheBvhPrimIndices, mesh.bvh.prim_indices);
+}
+
+static auto write_mesh_cache(const Mesh& mesh, const std::string& cache_filename, const MeshCacheKey& key) -> bool
+{
+    MeshCacheWriter cache{};
+    cache.add<Point3>(kCacheVertices, mesh.vertices);
+    cache.add<Vec3>(kCacheNormals, mesh.normals);
+    if (!mesh.large_faces.empty())
+    {
+        cache.add<Mesh::LargeFace>(kCacheFaces32, mesh.large_faces);
     }
+    else
+    {
+        cache.add<Mesh::Face>(kCacheFaces16, mesh.faces);
+    }
+    cache.add<Bvh::Node>(kCacheBvhNodes, mesh.bvh.nodes);
+    cache.add<std::uint32_t>(kCacheBvhPrimIndices, mesh.bvh.prim_indices);
+    return cache.write(cache_filename, key);
+}
 
+auto load_cached_mesh_from_file(Mesh& mesh, const std::string& filename, const float vertex_scale, ThreadPool* thread_pool) -> bool
+{
+    const std::string cache_filename = filename + ".raytrace.meshcache";
+    const MeshCacheKey key{ .source_filename = filename, .layout = kMeshCacheLayout, .vertex_scale = vertex_scale };
+
+    if (read_mesh_cache(mesh, cache_filename, key))
+    {
+        return true;
+    }
+
+    if (!load_obj_mesh_from_file(mesh, filename, vertex_scale, thread_pool))
+    {
+        return false;
+    }
+
+    // Best effort: without a writable asset directory, every run imports the OBJ again.
+    write_mesh_cache(mesh, cache_filename, key);
     return true;
 }
 
+// ========================================================
+// Acceleration structures:
+// ========================================================
+
+static auto compute_face_bounds(const Mesh& mesh) -> std::vector<Aabb>
+{
+    std::vector<Aabb> face_bounds{};
+    face_bounds.reserve(mesh.face_count());
+
+    mesh.visit_faces([&](const auto faces)
+    {
+        for (const auto& face : faces)
+        {
+            Aabb bounds{};
+            bounds.grow(mesh.vertices[face.verts[0]]);
+            bounds.grow(mesh.vertices[face.verts[1]]);
+            bounds.grow(mesh.vertices[face.verts[2]]);
+            face_bounds.push_back(bounds);
+        }
+    });
+
+    return face_bounds;
+}
+
+static auto compute_sphere_bounds(const Sphere& sphere) -> Aabb
+{
+    const float radius = std::sqrt(sphere.radius.squared);
+    const Vec3 extent = { radius, radius, radius };
+    return { .min = sphere.center - extent, .max = sphere.center + extent };
+}
+
+static auto compute_mesh_bounds(const Mesh& mesh) -> Aabb
+{
+    if (!mesh.bvh.is_empty())
+    {
+        return mesh.bvh.root_bounds();
+    }
+
+    Aabb bounds{};
+    for (const Point3& v : mesh.vertices)
+    {
+        bounds.grow(v);
+    }
+    return bounds;
+}
+
+// Bounds of every top-level primitive: spheres first, then meshes.
+static auto compute_scene_object_bounds(const Scene& scene) -> std::vector<Aabb>
+{
+    std::vector<Aabb> object_bounds{};
+    object_bounds.reserve(scene.spheres.size() + scene.meshes.size());
+
+    for (const Sphere& sphere : scene.spheres)
+    {
+        object_bounds.push_back(compute_sphere_bounds(sphere));
+    }
+
+    for (const Mesh& mesh : scene.meshes)
+    {
+        object_bounds.push_back(compute_mesh_bounds(mesh));
+    }
+
+    return object_bounds;
+}
+
+auto build_mesh_bvh(Mesh& mesh) -> void
+{
+    mesh.bvh = build_bvh(compute_face_bounds(mesh));
+}
+
+auto refit_mesh_bvh(Mesh& mesh) -> void
+{
+    refit_bvh(mesh.bvh, compute_face_bounds(mesh));
+}
+
+// Lays out the sphere data in leaf order. Non-sphere slots keep a negative radius.
+static auto update_sphere_soa(SceneBvh& scene_bvh, const Scene& scene) -> void
+{
+    SphereSoA& soa = scene_bvh.sphere_soa;
+    const std::size_t slot_count = scene_bvh.bvh.prim_indices.size() + SphereSoA::kLanes;
+
+    soa.center_x.assign(slot_count, 0.0f);
+    soa.center_y.assign(slot_count, 0.0f);
+    soa.center_z.assign(slot_count, 0.0f);
+    soa.radius_squared.assign(slot_count, -1.0f);
+    soa.sphere_index.assign(slot_count, 0);
+
+    for (std::size_t slot = 0; slot < scene_bvh.bvh.prim_indices.size(); ++slot)
+    {
+        const std::uint32_t object = scene_bvh.bvh.prim_indices[slot];
+        if (object >= scene_bvh.num_spheres)
+        {
+            continue;
+        }
+
+        const Sphere& sphere = scene.spheres[object];
+        soa.center_x[slot] = sphere.center.x;
+        soa.center_y[slot] = sphere.center.y;
+        soa.center_z[slot] = sphere.center.z;
+        soa.radius_squared[slot] = sphere.radius.squared;
+        soa.sphere_index[slot] = object;
+    }
+}
+
+auto build_scene_bvh(const Scene& scene) -> SceneBvh
+{
+    constexpr std::uint32_t kSceneLeafSize = 2 * SphereSoA::kLanes;
+
+    SceneBvh scene_bvh{
+        // Spheres are tested SphereSoA::kLanes at a time, so big leaves are cheap; up to two
+        // kernel iterations per leaf measured best. Meshes are already accelerated by their own BVH.
+        .bvh = build_bvh(compute_scene_object_bounds(scene), kSceneLeafSize, 1.0f / kSceneLeafSize),
+        .num_spheres = static_cast<std::uint32_t>(scene.spheres.size()),
+        .num_meshes = static_cast<std::uint32_t>(scene.meshes.size())
+    };
+
+    update_sphere_soa(scene_bvh, scene);
+    return scene_bvh;
+}
+
+auto refit_scene_bvh(SceneBvh& scene_bvh, const Scene& scene) -> void
+{
+    assert(scene_bvh.num_spheres == scene.spheres.size());
+    assert(scene_bvh.num_meshes == scene.meshes.size());
+
+    refit_bvh(scene_bvh.bvh, compute_scene_object_bounds(scene));
+    update_sphere_soa(scene_bvh, scene);
+}
+
 } // cgfs::raytracer
@@ -3,6 +3,8 @@
 #include "../common/vec3.hpp"
 #include "../common/mat3.hpp"
 #include "../common/color.hpp"
+#include "../common/thread_pool.hpp"
+#include "bvh.hpp"
 
 #include <vector>
 #include <span>
@@ -56,18 +58,50 @@ struct Mesh final
     // Could be per sub-mesh or even per face.
     Material material{};
 
-    struct Face final
+    template<typename IndexT>
+    struct BasicFace final
     {
         // Indices making a triangle or "face".
-        std::uint16_t verts[3]{};
+        IndexT verts[3]{};
 
         // Index of the face normal.
-        std::uint16_t normal{};
+        IndexT normal{};
     };
 
+    // Compact faces, for meshes with up to 65,536 vertices and normals.
+    using Face = BasicFace<std::uint16_t>;
+
+    // Faces of bigger meshes.
+    using LargeFace = BasicFace<std::uint32_t>;
+
     std::vector<Point3> vertices{};
     std::vector<Vec3> normals{};
+
+    // A mesh uses one of the two, depending on its index width.
     std::vector<Face> faces{};
+    std::vector<LargeFace> large_faces{};
+
+    auto face_count() const -> std::size_t
+    {
+        return faces.size() + large_faces.size();
+    }
+
+    // Calls `func` with a span of the faces of the mesh, whichever their index width,
+    // so loops over them are compiled once per width instead of checking it per face.
+    template<typename Func>
+    auto visit_faces(Func&& func) const -> decltype(auto)
+    {
+        if (!large_faces.empty())
+        {
+            return func(std::span<const LargeFace>{ large_faces });
+        }
+        return func(std::span<const Face>{ faces });
+    }
+
+    // Acceleration structure over `faces`. Built by load_obj_mesh_from_file(),
+    // or with build_mesh_bvh() for meshes assembled by hand. If empty, every
+    // face is tested against every ray.
+    Bvh bvh{};
 };
 
 struct Camera final
@@ -76,14 +110,65 @@ struct Camera final
     Mat3 rotation{ Mat3::kIdentity };
 };
 
+// Sphere centers and radii in structure-of-arrays layout, so one ray can be
+// tested against kLanes spheres at a time. Slot `i` mirrors `Bvh::prim_indices[i]`
+// of the scene BVH, which makes the spheres of a leaf contiguous. Slots holding meshes,
+// plus kLanes of padding at the end, have a negative radius and never report a hit.
+struct SphereSoA final
+{
+    static constexpr std::uint32_t kLanes = 8;
+
+    std::vector<float> center_x{};
+    std::vector<float> center_y{};
+    std::vector<float> center_z{};
+    std::vector<float> radius_squared{};
+    std::vector<std::uint32_t> sphere_index{}; // Index into Scene::spheres, which holds the material.
+};
+
+// Two-level acceleration structure: this is the top level, built over the
+// bounds of every sphere and mesh in a Scene. Each mesh brings its own
+// bottom-level tree (Mesh::bvh), so moving objects around only needs a refit
+// of this small tree, not a rebuild of the per-triangle ones.
+struct SceneBvh final
+{
+    // Primitive indices [0, num_spheres) are spheres, the rest are meshes.
+    Bvh bvh{};
+    std::uint32_t num_spheres{ 0 };
+    std::uint32_t num_meshes{ 0 };
+    SphereSoA sphere_soa{};
+};
+
 struct Scene final
 {
     std::span<const Sphere> spheres{};
     std::span<const Mesh> meshes{};
     std::span<const Light> lights{};
+
+    // Optional prebuilt acceleration structure for the spheres and meshes above.
+    // If null, raytrace() builds a temporary one for the duration of the call.
+    const SceneBvh* bvh{ nullptr };
 };
 
-// Simple .obj 3D model loader.
-auto load_obj_mesh_from_file(Mesh& mesh, const std::string& filename, const float vertex_scale = 1.0f) -> bool;
+// Simple .obj 3D model loader. See load_obj_file() for the optional thread pool.
+auto load_obj_mesh_from_file(Mesh& mesh, const std::string& filename, const float vertex_scale = 1.0f, ThreadPool* thread_pool = nullptr) -> bool;
+
+// load_obj_mesh_from_file() through a binary cache written next to the .obj file
+// (`<filename>.raytrace.meshcache`) on the first load, BVH included. Later loads
+// only copy the cached arrays, until the .obj file changes.
+auto load_cached_mesh_from_file(Mesh& mesh, const std::string& filename, const float vertex_scale = 1.0f, ThreadPool* thread_pool = nullptr) -> bool;
+
+// (Re)builds the mesh BVH. Must be called again if the faces change.
+auto build_mesh_bvh(Mesh& mesh) -> void;
+
+// Updates the mesh BVH bounds after its vertices moved, keeping the tree topology.
+// Much cheaper than a rebuild, but the tree degrades if vertices move very far.
+auto refit_mesh_bvh(Mesh& mesh) -> void;
+
+// Builds the top-level BVH over all scene spheres and meshes.
+auto build_scene_bvh(const Scene& scene) -> SceneBvh;
+
+// Updates the top-level bounds after spheres moved or meshes were refitted.
+// The scene must have the same objects, in the same order, used to build it.
+auto refit_scene_bvh(SceneBvh& scene_bvh, const Scene& scene) -> void;
 
 } // cgfs::raytracer
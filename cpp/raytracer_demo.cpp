@@ -36,7 +36,7 @@ struct DemoParams final
     bool refraction{ false };
 };
 
-static auto raytracer_demo_internal(const DemoParams& demo_params) -> void
+static auto raytracer_demo_internal(ThreadPool& thread_pool, const DemoParams& demo_params) -> void
 {
     // Scene setup:
     const Sphere spheres[] = {
@@ -165,7 +165,9 @@ static auto raytracer_demo_internal(const DemoParams& demo_params) -> void
     const RaytraceParams rt_params = {
         .camera = camera,
         .background_color = Color::kWhite,
-        .threading = Threading::k8Threads,
+        .threading = Threading::kAuto,
+        .thread_pool = &thread_pool,
+        .ray_packets = RayPackets::k4x4,
         .specular = demo_params.specular,
         .shadows = demo_params.shadows,
         .reflections = demo_params.reflections,
@@ -194,22 +196,22 @@ static auto raytracer_demo_internal(const DemoParams& demo_params) -> void
 }
 
 // Renders 5 different versions of our raytrace test scene with different lighting models.
-auto raytracer_demo() -> void
+auto raytracer_demo(ThreadPool& thread_pool) -> void
 {
     std::println("=== CGFS::raytracer_demo() ===");
 
     DemoParams demo_params = {};
-    raytracer_demo_internal(demo_params);
+    raytracer_demo_internal(thread_pool, demo_params);
 
     demo_params.specular = true;
-    raytracer_demo_internal(demo_params);
+    raytracer_demo_internal(thread_pool, demo_params);
     
     demo_params.shadows = true;
-    raytracer_demo_internal(demo_params);
+    raytracer_demo_internal(thread_pool, demo_params);
     
     demo_params.reflections = true;
-    raytracer_demo_internal(demo_params);
+    raytracer_demo_internal(thread_pool, demo_params);
     
     demo_params.refraction = true;
-    raytracer_demo_internal(demo_params);
+    raytracer_demo_internal(thread_pool, demo_params);
 }
@@ -1,3 +1,5 @@
 #pragma once
 
-auto raytracer_demo() -> void;
+#include "common/thread_pool.hpp"
+
+auto raytracer_demo(cgfs::ThreadPool& thread_pool) -> void;